@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "codeslayer-stub.h"
+
+/*
+ * Just enough of CodeSlayer to run the plugin without the editor. The 
+ * registry holds strings and has the signals the pane listens to, and the 
+ * active editor is whatever text view the caller hands over. Nothing here 
+ * is shown, the side pane and the menu bar calls do nothing.
+ */
+
+typedef struct
+{
+  GObject     parent_instance;
+  GHashTable *values;
+} StubRegistry;
+
+typedef struct
+{
+  GObjectClass parent_class;
+} StubRegistryClass;
+
+typedef struct
+{
+  GObject        parent_instance;
+  StubRegistry  *registry;
+  GtkAccelGroup *accel_group;
+  GtkWidget     *editor;
+  GObject       *document;
+} StubCodeSlayer;
+
+typedef struct
+{
+  GObjectClass parent_class;
+} StubCodeSlayerClass;
+
+static void stub_registry_class_init    (StubRegistryClass   *klass);
+static void stub_registry_init          (StubRegistry        *registry);
+static void stub_registry_finalize      (StubRegistry        *registry);
+static void stub_codeslayer_class_init  (StubCodeSlayerClass *klass);
+static void stub_codeslayer_init        (StubCodeSlayer      *codeslayer);
+static void stub_codeslayer_finalize    (StubCodeSlayer      *codeslayer);
+
+G_DEFINE_TYPE (StubRegistry, stub_registry, G_TYPE_OBJECT)
+G_DEFINE_TYPE (StubCodeSlayer, stub_codeslayer, G_TYPE_OBJECT)
+
+static void
+stub_registry_class_init (StubRegistryClass *klass)
+{
+  g_signal_new ("registry-initialized", G_TYPE_FROM_CLASS (klass),
+                G_SIGNAL_RUN_LAST, 0, NULL, NULL, 
+                g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+  g_signal_new ("registry-changed", G_TYPE_FROM_CLASS (klass),
+                G_SIGNAL_RUN_LAST, 0, NULL, NULL, 
+                g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+  
+  G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) stub_registry_finalize;
+}
+
+/*
+ * What the editor settings would be out of the box.
+ */
+static void
+stub_registry_init (StubRegistry *registry)
+{
+  registry->values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  g_hash_table_insert (registry->values, g_strdup (CODESLAYER_REGISTRY_EDITOR_TAB_WIDTH), 
+                       g_strdup ("4"));
+  g_hash_table_insert (registry->values, g_strdup (CODESLAYER_REGISTRY_EDITOR_FONT), 
+                       g_strdup ("Monospace 9"));
+}
+
+static void
+stub_registry_finalize (StubRegistry *registry)
+{
+  g_hash_table_destroy (registry->values);
+  G_OBJECT_CLASS (stub_registry_parent_class)->finalize (G_OBJECT (registry));
+}
+
+static void
+stub_codeslayer_class_init (StubCodeSlayerClass *klass)
+{
+  g_signal_new ("editor-saved", G_TYPE_FROM_CLASS (klass),
+                G_SIGNAL_RUN_LAST, 0, NULL, NULL, 
+                g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+  
+  G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) stub_codeslayer_finalize;
+}
+
+static void
+stub_codeslayer_init (StubCodeSlayer *codeslayer)
+{
+  codeslayer->registry = g_object_new (stub_registry_get_type (), NULL);
+  codeslayer->accel_group = gtk_accel_group_new ();
+  codeslayer->editor = NULL;
+  codeslayer->document = NULL;
+}
+
+static void
+stub_codeslayer_finalize (StubCodeSlayer *codeslayer)
+{
+  g_object_unref (codeslayer->registry);
+  g_object_unref (codeslayer->accel_group);
+  if (codeslayer->editor != NULL)
+    g_object_unref (codeslayer->editor);
+  if (codeslayer->document != NULL)
+    g_object_unref (codeslayer->document);
+  G_OBJECT_CLASS (stub_codeslayer_parent_class)->finalize (G_OBJECT (codeslayer));
+}
+
+CodeSlayer*
+codeslayer_stub_new (void)
+{
+  return (CodeSlayer*) g_object_new (stub_codeslayer_get_type (), NULL);
+}
+
+void
+codeslayer_stub_free (CodeSlayer *codeslayer)
+{
+  g_object_unref (codeslayer);
+}
+
+/*
+ * Make the text view the active editor, showing the file.
+ */
+void
+codeslayer_stub_set_editor (CodeSlayer  *codeslayer,
+                            GtkWidget   *editor,
+                            const gchar *file_path)
+{
+  StubCodeSlayer *stub = (StubCodeSlayer*) codeslayer;
+  
+  if (stub->editor != NULL)
+    g_object_unref (stub->editor);
+  if (stub->document != NULL)
+    g_object_unref (stub->document);
+  
+  stub->editor = g_object_ref_sink (editor);
+  stub->document = g_object_new (G_TYPE_OBJECT, NULL);
+  g_object_set_data_full (stub->document, "file_path", g_strdup (file_path), g_free);
+  g_object_set_data (G_OBJECT (editor), "document", stub->document);
+}
+
+CodeSlayerRegistry*
+codeslayer_get_registry (CodeSlayer *codeslayer)
+{
+  return (CodeSlayerRegistry*) ((StubCodeSlayer*) codeslayer)->registry;
+}
+
+GtkAccelGroup*
+codeslayer_get_menu_bar_accel_group (CodeSlayer *codeslayer)
+{
+  return ((StubCodeSlayer*) codeslayer)->accel_group;
+}
+
+CodeSlayerEditor*
+codeslayer_get_active_editor (CodeSlayer *codeslayer)
+{
+  return (CodeSlayerEditor*) ((StubCodeSlayer*) codeslayer)->editor;
+}
+
+CodeSlayerDocument*
+codeslayer_get_active_editor_document (CodeSlayer *codeslayer)
+{
+  return (CodeSlayerDocument*) ((StubCodeSlayer*) codeslayer)->document;
+}
+
+CodeSlayerDocument*
+codeslayer_editor_get_document (CodeSlayerEditor *editor)
+{
+  return (CodeSlayerDocument*) g_object_get_data (G_OBJECT (editor), "document");
+}
+
+const gchar*
+codeslayer_document_get_file_path (CodeSlayerDocument *document)
+{
+  return g_object_get_data (G_OBJECT (document), "file_path");
+}
+
+gboolean
+codeslayer_select_editor_by_file_path (CodeSlayer  *codeslayer,
+                                       const gchar *file_path,
+                                       gint         line_number)
+{
+  return FALSE;
+}
+
+void
+codeslayer_add_to_menu_bar (CodeSlayer  *codeslayer,
+                            GtkMenuItem *menuitem)
+{
+}
+
+void
+codeslayer_remove_from_menu_bar (CodeSlayer  *codeslayer,
+                                 GtkMenuItem *menuitem)
+{
+}
+
+void
+codeslayer_add_to_side_pane (CodeSlayer  *codeslayer,
+                             GtkWidget   *widget,
+                             const gchar *label)
+{
+}
+
+void
+codeslayer_remove_from_side_pane (CodeSlayer *codeslayer,
+                                  GtkWidget  *widget)
+{
+}
+
+void
+codeslayer_show_side_pane (CodeSlayer *codeslayer,
+                           GtkWidget  *widget)
+{
+}
+
+gchar*
+codeslayer_registry_get_string (CodeSlayerRegistry *registry,
+                                const gchar        *key)
+{
+  return g_strdup (g_hash_table_lookup (((StubRegistry*) registry)->values, key));
+}
+
+void
+codeslayer_registry_set_string (CodeSlayerRegistry *registry,
+                                const gchar        *key,
+                                const gchar        *value)
+{
+  g_hash_table_insert (((StubRegistry*) registry)->values, g_strdup (key), g_strdup (value));
+}
+
+gdouble
+codeslayer_registry_get_double (CodeSlayerRegistry *registry,
+                                const gchar        *key)
+{
+  const gchar *value = g_hash_table_lookup (((StubRegistry*) registry)->values, key);
+  return value != NULL ? g_ascii_strtod (value, NULL) : 0;
+}
+
+gboolean
+codeslayer_registry_get_boolean (CodeSlayerRegistry *registry,
+                                 const gchar        *key)
+{
+  const gchar *value = g_hash_table_lookup (((StubRegistry*) registry)->values, key);
+  return g_strcmp0 (value, "true") == 0;
+}
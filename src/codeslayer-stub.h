@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_STUB_H__
+#define	__CODESLAYER_STUB_H__
+
+#include <gtk/gtk.h>
+#include <codeslayer/codeslayer.h>
+
+G_BEGIN_DECLS
+
+CodeSlayer*  codeslayer_stub_new         (void);
+void         codeslayer_stub_free        (CodeSlayer  *codeslayer);
+void         codeslayer_stub_set_editor  (CodeSlayer  *codeslayer,
+                                          GtkWidget   *editor,
+                                          const gchar *file_path);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_STUB_H__ */
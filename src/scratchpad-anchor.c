@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-anchor.h"
+
+/*
+ * A snippet is found again in a changed file by one of its lines, the 
+ * anchor. The longest line that is not the first or the last is used 
+ * since those two can be partial when the selection did not start or 
+ * end at a line boundary. Lines are compared with the indentation taken 
+ * off so that reindenting the code does not lose it.
+ *
+ * The search starts at the line the snippet was last known to be at and 
+ * works outward, so code that moved by a few lines is found after looking 
+ * at a few lines, and only the one document is looked at.
+ */
+
+#define NO_ANCHOR -1
+
+static gchar** get_lines          (const gchar       *text,
+                                   guint             *count);
+static void compute_anchor        (ScratchpadSnippet *snippet,
+                                   gchar            **lines,
+                                   guint              count);
+static gchar* get_buffer_line     (GtkTextBuffer     *buffer,
+                                   gint               line);
+static gboolean matches_anchor    (ScratchpadSnippet *snippet,
+                                   gchar            **lines,
+                                   const gchar       *line);
+static gboolean matches_lines     (GtkTextBuffer     *buffer,
+                                   gchar            **lines,
+                                   guint              count,
+                                   gint               start);
+
+/*
+ * Find where the snippet is in the buffer now. Returns FALSE when it is 
+ * not there anymore, in which case the line number is left alone.
+ */
+gboolean
+scratchpad_anchor_resolve (ScratchpadSnippet *snippet,
+                           GtkTextBuffer     *buffer,
+                           gint              *line_number)
+{
+  gchar **lines;
+  guint count;
+  gint buffer_lines;
+  gint expected;
+  gint distance;
+  gboolean found = FALSE;
+
+  lines = get_lines (snippet->text, &count);
+  if (count == 0)
+    {
+      g_strfreev (lines);
+      return FALSE;
+    }
+  
+  if (!snippet->anchored)
+    compute_anchor (snippet, lines, count);
+  
+  buffer_lines = gtk_text_buffer_get_line_count (buffer);
+  expected = snippet->line_number - 1 + snippet->anchor_line;
+  
+  for (distance = 0; !found && distance < buffer_lines; distance++)
+    {
+      gint candidates[2];
+      guint i;
+
+      candidates[0] = expected - distance;
+      candidates[1] = distance > 0 ? expected + distance : -1;
+
+      for (i = 0; !found && i < G_N_ELEMENTS (candidates); i++)
+        {
+          gint start;
+          gchar *line;
+          
+          if (candidates[i] < 0 || candidates[i] >= buffer_lines)
+            continue;
+
+          line = get_buffer_line (buffer, candidates[i]);
+          start = candidates[i] - snippet->anchor_line;
+          
+          if (start >= 0 && matches_anchor (snippet, lines, line) &&
+              matches_lines (buffer, lines, count, start))
+            {
+              *line_number = start + 1;
+              found = TRUE;
+            }
+
+          g_free (line);
+        }
+      
+      /* past both ends of the buffer */
+      if (expected - distance < 0 && expected + distance >= buffer_lines)
+        break;
+    }
+  
+  g_strfreev (lines);
+  
+  return found;
+}
+
+/*
+ * The lines of the text with the indentation and trailing blanks taken
+ * off. A final newline does not start another line.
+ */
+static gchar**
+get_lines (const gchar *text,
+           guint       *count)
+{
+  gchar **lines;
+  guint i;
+
+  lines = g_strsplit (text, "\n", -1);
+  *count = g_strv_length (lines);
+  
+  if (*count > 0 && lines[*count - 1][0] == '\0')
+    {
+      g_free (lines[*count - 1]);
+      lines[--(*count)] = NULL;
+    }
+  
+  for (i = 0; i < *count; i++)
+    g_strstrip (lines[i]);
+
+  return lines;
+}
+
+static void
+compute_anchor (ScratchpadSnippet *snippet,
+                gchar            **lines,
+                guint              count)
+{
+  gsize longest = 0;
+  guint i;
+
+  snippet->anchor_line = NO_ANCHOR;
+
+  for (i = 1; i + 1 < count; i++)
+    {
+      gsize length = strlen (lines[i]);
+      if (length > longest)
+        {
+          longest = length;
+          snippet->anchor_line = i;
+        }
+    }
+  
+  /* two lines or less, any of them may be partial */
+  if (snippet->anchor_line == NO_ANCHOR)
+    {
+      snippet->anchor_line = 0;
+      snippet->anchor = 0;
+    }
+  else
+    {
+      snippet->anchor = g_str_hash (lines[snippet->anchor_line]);
+    }
+
+  snippet->anchored = TRUE;
+}
+
+static gchar*
+get_buffer_line (GtkTextBuffer *buffer,
+                 gint           line)
+{
+  GtkTextIter start, end;
+  
+  gtk_text_buffer_get_iter_at_line (buffer, &start, line);
+  end = start;
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  return g_strstrip (gtk_text_buffer_get_slice (buffer, &start, &end, TRUE));
+}
+
+/*
+ * The cheap test that every candidate line goes through. A whole line is 
+ * compared by its hash first, a possibly partial one has to be in there.
+ */
+static gboolean
+matches_anchor (ScratchpadSnippet *snippet,
+                gchar            **lines,
+                const gchar       *line)
+{
+  if (snippet->anchor == 0 && snippet->anchor_line == 0)
+    return strstr (line, lines[0]) != NULL;
+  
+  return g_str_hash (line) == snippet->anchor && 
+         strcmp (line, lines[snippet->anchor_line]) == 0;
+}
+
+/*
+ * The first line of the snippet only has to end the line in the buffer 
+ * and the last line only has to start it.
+ */
+static gboolean
+matches_lines (GtkTextBuffer  *buffer,
+               gchar         **lines,
+               guint           count,
+               gint            start)
+{
+  gboolean matches = TRUE;
+  guint i;
+  
+  if (start + (gint) count > gtk_text_buffer_get_line_count (buffer))
+    return FALSE;
+
+  for (i = 0; matches && i < count; i++)
+    {
+      gchar *line = get_buffer_line (buffer, start + i);
+      
+      if (count == 1)
+        matches = strstr (line, lines[i]) != NULL;
+      else if (i == 0)
+        matches = g_str_has_suffix (line, lines[i]);
+      else if (i == count - 1)
+        matches = g_str_has_prefix (line, lines[i]);
+      else
+        matches = strcmp (line, lines[i]) == 0;
+      
+      g_free (line);
+    }
+  
+  return matches;
+}
@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <glib/gstdio.h>
+#include <gtksourceview/gtksourceview.h>
+#include "codeslayer-stub.h"
+#include "scratchpad-pane.h"
+#include "scratchpad-palette.h"
+#include "scratchpad-menu.h"
+#include "scratchpad-pads.h"
+#include "scratchpad-engine.h"
+
+/*
+ * Measurements of the pad, run by make check against a stub of CodeSlayer.
+ * Each one works on a pane of its own, which is never shown and has no 
+ * journal, and writes a line of json per result so that runs can be 
+ * compared from one build to the next.
+ */
+
+#define SAMPLES 200
+
+/* what automake takes as a test that could not be run */
+#define EXIT_SKIP 77
+
+static const gchar *SAMPLE_TEXT = 
+  "static void\n"
+  "copy_action (ScratchpadEngine *engine)\n"
+  "{\n"
+  "  ScratchpadEnginePrivate *priv;\n"
+  "  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);\n"
+  "  g_thread_pool_push (priv->pool, batch, NULL);\n"
+  "}\n";
+
+static const guint PAD_SIZES[] = {100, 1000, 5000, 10000, 20000};
+
+/* the pad grows two hundred times over, an add may only slow down this much */
+#define ADD_TEXT_GROWTH 4.0
+
+/* the palette is meant to keep up with typing at this many snippets */
+#define PALETTE_SIZE 50000
+#define PALETTE_ROWS 50
+
+static const gchar *PALETTE_WORDS[] = {
+  "engine", "pane", "store", "journal", "search", "export", "anchor", 
+  "highlighter", "stats", "undo", "share", "pads", "menu", "plugin"
+};
+
+static const gchar *PALETTE_QUERIES[] = {"scrpane", "storec:12", "undo action"};
+
+#ifdef __GLIBC__
+
+/* a few lines up to a whole generated file */
+static const guint CAPTURE_SIZES[] = {1024, 1024 * 1024};
+#define CAPTURE_SAMPLES 10
+
+/*
+ * Every allocation made on the thread that is being measured goes through
+ * here. A realloc only counts what it adds to the block.
+ */
+extern void *__libc_malloc  (size_t size);
+extern void *__libc_calloc  (size_t count, size_t size);
+extern void *__libc_realloc (void *memory, size_t size);
+
+static __thread gboolean counting = FALSE;
+static gsize allocated_bytes = 0;
+static guint allocations = 0;
+
+void*
+malloc (size_t size)
+{
+  if (counting)
+    {
+      allocated_bytes += size;
+      allocations++;
+    }
+  return __libc_malloc (size);
+}
+
+void*
+calloc (size_t count,
+        size_t size)
+{
+  if (counting)
+    {
+      allocated_bytes += count * size;
+      allocations++;
+    }
+  return __libc_calloc (count, size);
+}
+
+void*
+realloc (void   *memory,
+         size_t  size)
+{
+  if (counting)
+    {
+      size_t usable = memory != NULL ? malloc_usable_size (memory) : 0;
+      if (size > usable)
+        allocated_bytes += size - usable;
+      allocations++;
+    }
+  return __libc_realloc (memory, size);
+}
+
+#endif
+
+static GtkWidget* benchmark_pane_new   (CodeSlayer  *codeslayer);
+static void benchmark_pane_free        (GtkWidget   *pane);
+static void fill_pane                  (GtkWidget   *pane,
+                                        guint        count,
+                                        gboolean     linked);
+static gdouble time_adds               (GtkWidget   *pane,
+                                        guint        count,
+                                        gboolean     linked);
+static glong get_resident_size         (void);
+static gboolean add_text_benchmark     (CodeSlayer  *codeslayer,
+                                        GString     *results);
+static void link_benchmark             (CodeSlayer  *codeslayer,
+                                        GString     *results);
+static void memory_benchmark           (CodeSlayer  *codeslayer,
+                                        GString     *results);
+static void registry_benchmark         (CodeSlayer  *codeslayer,
+                                        GString     *results);
+static void palette_benchmark          (GString     *results);
+#ifdef __GLIBC__
+static void capture_benchmark          (CodeSlayer  *codeslayer,
+                                        GString     *results);
+static void remove_folder              (const gchar *folder_path);
+#endif
+
+/*
+ * Run all of the benchmarks and write the results to the file named on 
+ * the command line, or to standard out. Without a display there is no 
+ * pane to measure and the run is skipped.
+ */
+int
+main (int   argc,
+      char *argv[])
+{
+  CodeSlayer *codeslayer;
+  GString *results;
+  GError *error = NULL;
+  gboolean failed = FALSE;
+  
+  if (!gtk_init_check (&argc, &argv))
+    return EXIT_SKIP;
+  
+  codeslayer = codeslayer_stub_new ();
+  results = g_string_new (NULL);
+  
+  if (!add_text_benchmark (codeslayer, results))
+    failed = TRUE;
+  link_benchmark (codeslayer, results);
+  memory_benchmark (codeslayer, results);
+  registry_benchmark (codeslayer, results);
+  palette_benchmark (results);
+#ifdef __GLIBC__
+  capture_benchmark (codeslayer, results);
+#endif
+
+  if (argc < 2)
+    {
+      fputs (results->str, stdout);
+      fflush (stdout);
+    }
+  else if (!g_file_set_contents (argv[1], results->str, results->len, &error))
+    {
+      g_printerr ("scratchpad benchmark: %s\n", error->message);
+      g_error_free (error);
+      failed = TRUE;
+    }
+
+  g_string_free (results, TRUE);
+  codeslayer_stub_free (codeslayer);
+  
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Latency of a single add as the pad grows, to catch anything that is 
+ * proportional to what is already in it. Each size is given against the
+ * smallest pad, and the run fails when the largest pad is more than 
+ * ADD_TEXT_GROWTH times slower to add to.
+ */
+static gboolean
+add_text_benchmark (CodeSlayer *codeslayer,
+                    GString    *results)
+{
+  GtkWidget *pane;
+  gdouble smallest = 0;
+  gdouble growth = 1;
+  guint size = 0;
+  guint i;
+
+  pane = benchmark_pane_new (codeslayer);
+
+  for (i = 0; i < G_N_ELEMENTS (PAD_SIZES); i++)
+    {
+      gdouble usec;
+
+      fill_pane (pane, PAD_SIZES[i] - size, TRUE);
+      usec = time_adds (pane, SAMPLES, TRUE);
+      size = PAD_SIZES[i] + SAMPLES;
+      
+      if (i == 0)
+        smallest = MAX (usec, 1);
+      growth = usec / smallest;
+
+      g_string_append_printf (results, 
+                              "{\"benchmark\": \"add_text\", \"pad_size\": %u, \"usec\": %.2f, "
+                              "\"vs_smallest\": %.2f}\n",
+                              PAD_SIZES[i], usec, growth);
+    }
+
+  benchmark_pane_free (pane);
+  
+  if (growth > ADD_TEXT_GROWTH)
+    {
+      g_printerr ("scratchpad benchmark: an add to %u snippets is %.1f times slower than to %u\n",
+                  PAD_SIZES[G_N_ELEMENTS (PAD_SIZES) - 1], growth, PAD_SIZES[0]);
+      return FALSE;
+    }
+  
+  return TRUE;
+}
+
+/*
+ * What a header with a line number costs over one without, which is the
+ * link that goes with it.
+ */
+static void
+link_benchmark (CodeSlayer *codeslayer,
+                GString    *results)
+{
+  GtkWidget *pane;
+  gdouble linked;
+  gdouble unlinked;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (PAD_SIZES); i++)
+    {
+      pane = benchmark_pane_new (codeslayer);
+      fill_pane (pane, PAD_SIZES[i], TRUE);
+      linked = time_adds (pane, SAMPLES, TRUE);
+      benchmark_pane_free (pane);
+
+      pane = benchmark_pane_new (codeslayer);
+      fill_pane (pane, PAD_SIZES[i], FALSE);
+      unlinked = time_adds (pane, SAMPLES, FALSE);
+      benchmark_pane_free (pane);
+
+      g_string_append_printf (results, 
+                              "{\"benchmark\": \"link\", \"pad_size\": %u, \"usec\": %.2f}\n",
+                              PAD_SIZES[i], linked - unlinked);
+    }
+}
+
+/*
+ * Growth of the resident size per snippet, buffer and all. This depends 
+ * on what the allocator hands back to the system so it is only a rough 
+ * number, and it is left out where /proc is not around.
+ */
+static void
+memory_benchmark (CodeSlayer *codeslayer,
+                  GString    *results)
+{
+  GtkWidget *pane;
+  glong before;
+  glong after;
+  guint count;
+
+  count = PAD_SIZES[G_N_ELEMENTS (PAD_SIZES) - 1];
+
+  pane = benchmark_pane_new (codeslayer);
+
+  before = get_resident_size ();
+  fill_pane (pane, count, TRUE);
+  after = get_resident_size ();
+  
+  benchmark_pane_free (pane);
+
+  if (before < 0 || after < 0)
+    return;
+
+  g_string_append_printf (results, 
+                          "{\"benchmark\": \"memory\", \"pad_size\": %u, \"bytes_per_snippet\": %.1f, \"text_bytes\": %"
+                          G_GSIZE_FORMAT "}\n",
+                          count, (gdouble) (after - before) / count, strlen (SAMPLE_TEXT));
+}
+
+/*
+ * The whole round trip that every change to the settings goes through,
+ * with a full pad listening in. The stub registry has no other listeners.
+ */
+static void
+registry_benchmark (CodeSlayer *codeslayer,
+                    GString    *results)
+{
+  CodeSlayerRegistry *registry;
+  GtkWidget *pane;
+  gint64 start_time;
+  guint i;
+
+  registry = codeslayer_get_registry (codeslayer);
+
+  pane = benchmark_pane_new (codeslayer);
+  fill_pane (pane, PAD_SIZES[G_N_ELEMENTS (PAD_SIZES) - 1], TRUE);
+  
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < SAMPLES; i++)
+    {
+      g_signal_emit_by_name (registry, "registry-changed");
+      
+      /* the settings are applied from an idle callback */
+      while (g_main_context_iteration (NULL, FALSE));
+    }
+
+  g_string_append_printf (results, 
+                          "{\"benchmark\": \"registry_changed\", \"pad_size\": %u, \"usec\": %.2f}\n",
+                          PAD_SIZES[G_N_ELEMENTS (PAD_SIZES) - 1], 
+                          (gdouble) (g_get_monotonic_time () - start_time) / SAMPLES);
+  
+  benchmark_pane_free (pane);
+}
+
+/*
+ * Ranking for the jump palette one keystroke at a time, the way a query 
+ * gets typed, and the worst of the keystrokes. This works on the store 
+ * and the index without a pane since filling a buffer with this many 
+ * snippets would take longer than everything else put together.
+ */
+static void
+palette_benchmark (GString *results)
+{
+  ScratchpadStore *store;
+  ScratchpadPalette *palette;
+  gchar file_path[64];
+  guint words;
+  guint i;
+
+  store = scratchpad_store_new ();
+  palette = scratchpad_palette_new (store);
+  
+  words = G_N_ELEMENTS (PALETTE_WORDS);
+  for (i = 0; i < PALETTE_SIZE; i++)
+    {
+      ScratchpadSnippet *snippet;
+      gchar *text;
+      
+      g_snprintf (file_path, sizeof (file_path), "/home/user/src/scratchpad-%s-%s.c", 
+                  PALETTE_WORDS[i % words], PALETTE_WORDS[(i / words) % words]);
+      text = g_strdup_printf ("%s_%u_action ();\n%s", PALETTE_WORDS[(i / 7) % words], 
+                              i, SAMPLE_TEXT);
+      
+      snippet = scratchpad_store_add (store, file_path, i + 1, text);
+      scratchpad_palette_add (palette, snippet);
+    }
+  
+  for (i = 0; i < G_N_ELEMENTS (PALETTE_QUERIES); i++)
+    {
+      const gchar *query = PALETTE_QUERIES[i];
+      gint64 total = 0;
+      gint64 worst = 0;
+      gsize length;
+      gsize j;
+      
+      length = strlen (query);
+      for (j = 1; j <= length; j++)
+        {
+          gchar *typed;
+          gint64 start_time;
+          gint64 usec;
+          
+          typed = g_strndup (query, j);
+          start_time = g_get_monotonic_time ();
+          g_array_unref (scratchpad_palette_rank (palette, typed, PALETTE_ROWS));
+          usec = g_get_monotonic_time () - start_time;
+          g_free (typed);
+          
+          total += usec;
+          worst = MAX (worst, usec);
+        }
+
+      g_string_append_printf (results, 
+                              "{\"benchmark\": \"palette\", \"pad_size\": %u, \"query\": \"%s\", "
+                              "\"usec\": %.2f, \"worst_usec\": %" G_GINT64_FORMAT "}\n",
+                              PALETTE_SIZE, query, (gdouble) total / length, worst);
+    }
+  
+  g_object_unref (palette);
+  g_object_unref (store);
+}
+
+#ifdef __GLIBC__
+
+/*
+ * The bytes allocated on the main loop by a copy from the editor, from the
+ * menu action until the capture is handed to the worker. The text has to 
+ * be taken out of the editor once and nothing on the way should copy it 
+ * again. Only glibc lets the allocations be counted.
+ */
+static void
+capture_benchmark (CodeSlayer *codeslayer,
+                   GString    *results)
+{
+  ScratchpadEngine *engine;
+  ScratchpadStore *store;
+  GtkSourceBuffer *buffer;
+  GtkWidget *editor;
+  GtkWidget *menu;
+  GtkWidget *pads;
+  gchar *folder_path;
+  guint i;
+
+  folder_path = g_dir_make_tmp ("scratchpad-benchmark-XXXXXX", NULL);
+  if (folder_path == NULL)
+    return;
+  
+  menu = g_object_ref_sink (scratchpad_menu_new (codeslayer_get_menu_bar_accel_group (codeslayer)));
+  pads = g_object_ref_sink (scratchpad_pads_new (codeslayer, folder_path));
+  engine = scratchpad_engine_new (codeslayer, menu, pads);
+  
+  buffer = gtk_source_buffer_new (NULL);
+  editor = gtk_source_view_new_with_buffer (buffer);
+  codeslayer_stub_set_editor (codeslayer, editor, "/tmp/benchmark.c");
+  
+  store = scratchpad_pane_get_store (scratchpad_pads_get_pane (SCRATCHPAD_PADS (pads)));
+
+  for (i = 0; i < G_N_ELEMENTS (CAPTURE_SIZES); i++)
+    {
+      GString *text;
+      gsize total_bytes = 0;
+      guint total_allocations = 0;
+      guint j;
+      
+      text = g_string_new (NULL);
+      while (text->len < CAPTURE_SIZES[i] + CAPTURE_SAMPLES)
+        g_string_append (text, SAMPLE_TEXT);
+      gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), text->str, 
+                                CAPTURE_SIZES[i] + CAPTURE_SAMPLES);
+      g_string_free (text, TRUE);
+      
+      /* the first capture is left out, it interns the file path, and each
+         one after is a byte shorter so that the store never folds it into
+         the one before */
+      for (j = 0; j <= CAPTURE_SAMPLES; j++)
+        {
+          GtkTextIter start, end;
+          guint length;
+          
+          gtk_text_buffer_get_start_iter (GTK_TEXT_BUFFER (buffer), &start);
+          gtk_text_buffer_get_iter_at_offset (GTK_TEXT_BUFFER (buffer), &end, 
+                                              CAPTURE_SIZES[i] + CAPTURE_SAMPLES - j);
+          gtk_text_buffer_select_range (GTK_TEXT_BUFFER (buffer), &start, &end);
+          
+          length = scratchpad_store_get_length (store);
+          
+          allocated_bytes = 0;
+          allocations = 0;
+          counting = TRUE;
+          g_signal_emit_by_name (menu, "copy");
+          counting = FALSE;
+          
+          if (j > 0)
+            {
+              total_bytes += allocated_bytes;
+              total_allocations += allocations;
+            }
+          
+          /* the snippet reaches the pane from an idle callback */
+          while (scratchpad_store_get_length (store) == length)
+            g_main_context_iteration (NULL, TRUE);
+        }
+
+      g_string_append_printf (results, 
+                              "{\"benchmark\": \"capture\", \"text_bytes\": %u, "
+                              "\"bytes_allocated\": %.1f, \"allocations\": %.1f}\n",
+                              CAPTURE_SIZES[i], (gdouble) total_bytes / CAPTURE_SAMPLES,
+                              (gdouble) total_allocations / CAPTURE_SAMPLES);
+    }
+  
+  g_object_unref (engine);
+  gtk_widget_destroy (pads);
+  g_object_unref (pads);
+  gtk_widget_destroy (menu);
+  g_object_unref (menu);
+  g_object_unref (buffer);
+  
+  remove_folder (folder_path);
+  g_free (folder_path);
+}
+
+#endif
+
+static GtkWidget*
+benchmark_pane_new (CodeSlayer *codeslayer)
+{
+  GtkWidget *pane;
+  pane = scratchpad_pane_new (codeslayer);
+  g_object_ref_sink (pane);
+  return pane;
+}
+
+static void
+benchmark_pane_free (GtkWidget *pane)
+{
+  gtk_widget_destroy (pane);
+  g_object_unref (pane);
+}
+
+/*
+ * Every header is different so that none of the snippets are taken for
+ * a repeat of another.
+ */
+static void
+fill_pane (GtkWidget *pane,
+           guint      count,
+           gboolean   linked)
+{
+  gchar header[64];
+  guint i;
+  
+  for (i = 0; i < count; i++)
+    {
+      if (linked)
+        g_snprintf (header, sizeof (header), "/tmp/benchmark.c:%u", i + 1);
+      else
+        g_snprintf (header, sizeof (header), "/tmp/benchmark-%u.c", i + 1);
+
+      scratchpad_pane_add_text (SCRATCHPAD_PANE (pane), header, SAMPLE_TEXT);
+    }
+}
+
+/*
+ * The mean time in microseconds of adding one more snippet.
+ */
+static gdouble
+time_adds (GtkWidget *pane,
+           guint      count,
+           gboolean   linked)
+{
+  gint64 start_time;
+  
+  start_time = g_get_monotonic_time ();
+  fill_pane (pane, count, linked);
+  
+  return (gdouble) (g_get_monotonic_time () - start_time) / count;
+}
+
+#ifdef __GLIBC__
+
+static void
+remove_folder (const gchar *folder_path)
+{
+  const gchar *name;
+  GDir *dir;
+  
+  dir = g_dir_open (folder_path, 0, NULL);
+  if (dir == NULL)
+    return;
+  
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *path = g_build_filename (folder_path, name, NULL);
+      if (g_file_test (path, G_FILE_TEST_IS_DIR))
+        remove_folder (path);
+      else
+        g_remove (path);
+      g_free (path);
+    }
+  
+  g_dir_close (dir);
+  g_rmdir (folder_path);
+}
+
+#endif
+
+/*
+ * The resident size in bytes, or -1 when it can not be found out.
+ */
+static glong
+get_resident_size (void)
+{
+  gchar *contents;
+  glong pages = -1;
+  gchar **fields;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    return -1;
+  
+  fields = g_strsplit (contents, " ", 3);
+  if (fields[0] != NULL && fields[1] != NULL)
+    pages = strtol (fields[1], NULL, 10);
+  
+  g_strfreev (fields);
+  g_free (contents);
+  
+  if (pages < 0)
+    return -1;
+
+  return pages * sysconf (_SC_PAGESIZE);
+}
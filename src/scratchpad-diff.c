@@ -0,0 +1,681 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-diff.h"
+#include "scratchpad-stats.h"
+
+/*
+ * Line diffs worked out on a thread of their own. Every line is swapped 
+ * for a number that is the same for the same text on either side, and 
+ * the two lists of numbers are compared with the linear space version of
+ * Myers' algorithm, which splits on the middle snake of the shortest edit
+ * path and works on each half. Only the newest diff asked for is finished, 
+ * anything still going when another one comes in is cancelled.
+ */
+
+typedef struct
+{
+  const gchar *text;
+  guint        length;
+} Line;
+
+typedef struct
+{
+  ScratchpadDiff       *diff;
+  GCancellable         *cancellable;
+  gchar                *old_text;
+  gchar                *new_text;
+  gchar                *file_path;
+  gchar                *contents;
+  gint                  line_number;
+  ScratchpadDiffResult *result;
+} Job;
+
+typedef struct
+{
+  const guint  *a;
+  const guint  *b;
+  guint8       *removed;
+  guint8       *added;
+  gint         *fd;
+  gint         *bd;
+  GCancellable *cancellable;
+} Compare;
+
+static void scratchpad_diff_class_init  (ScratchpadDiffClass *klass);
+static void scratchpad_diff_init        (ScratchpadDiff      *diff);
+static void scratchpad_diff_finalize    (ScratchpadDiff      *diff);
+
+static void start_job                   (ScratchpadDiff      *diff,
+                                         Job                 *job);
+static void run_job                     (Job                 *job,
+                                         ScratchpadDiff      *diff);
+static gboolean finish_job              (Job                 *job);
+static void job_free                    (Job                 *job);
+static gchar* read_source               (Job                 *job);
+static GArray* split_lines              (const gchar         *text);
+static guint* number_lines              (GArray              *lines,
+                                         GHashTable          *numbers);
+static guint line_hash                  (const Line          *line);
+static gboolean line_equal              (const Line          *line1,
+                                         const Line          *line2);
+static void compare                     (Compare             *compare,
+                                         gint                 xoff,
+                                         gint                 xlim,
+                                         gint                 yoff,
+                                         gint                 ylim);
+static void find_middle                 (Compare             *compare,
+                                         gint                 xoff,
+                                         gint                 xlim,
+                                         gint                 yoff,
+                                         gint                 ylim,
+                                         gint                *xmid,
+                                         gint                *ymid);
+static void append_line                 (ScratchpadDiffResult *result,
+                                         ScratchpadDiffKind   kind,
+                                         const Line          *line);
+
+enum
+{
+  FINISHED,
+  LAST_SIGNAL
+};
+
+static guint scratchpad_diff_signals[LAST_SIGNAL] = { 0 };
+
+#define SCRATCHPAD_DIFF_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_DIFF_TYPE, ScratchpadDiffPrivate))
+
+typedef struct _ScratchpadDiffPrivate ScratchpadDiffPrivate;
+
+struct _ScratchpadDiffPrivate
+{
+  GThreadPool  *pool;
+  GCancellable *cancellable;
+};
+
+G_DEFINE_TYPE (ScratchpadDiff, scratchpad_diff, G_TYPE_OBJECT)
+
+static void
+scratchpad_diff_class_init (ScratchpadDiffClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  scratchpad_diff_signals[FINISHED] =
+    g_signal_new ("finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (ScratchpadDiffClass, finished),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_diff_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadDiffPrivate));
+}
+
+static void
+scratchpad_diff_init (ScratchpadDiff *diff) 
+{
+  ScratchpadDiffPrivate *priv;
+  priv = SCRATCHPAD_DIFF_GET_PRIVATE (diff);
+  priv->pool = g_thread_pool_new ((GFunc) run_job, diff, 1, FALSE, NULL);
+  priv->cancellable = NULL;
+}
+
+/*
+ * A job that is done but not yet finished off on the main loop sees that 
+ * it was cancelled and never gets to the diff.
+ */
+static void
+scratchpad_diff_finalize (ScratchpadDiff *diff)
+{
+  ScratchpadDiffPrivate *priv;
+  priv = SCRATCHPAD_DIFF_GET_PRIVATE (diff);
+  scratchpad_diff_cancel (diff);
+  g_thread_pool_free (priv->pool, FALSE, TRUE);
+  G_OBJECT_CLASS (scratchpad_diff_parent_class)->finalize (G_OBJECT (diff));
+}
+
+ScratchpadDiff*
+scratchpad_diff_new (void)
+{
+  return SCRATCHPAD_DIFF (g_object_new (scratchpad_diff_get_type (), NULL));
+}
+
+/*
+ * Diff two texts. The texts are copied.
+ */
+void
+scratchpad_diff_texts (ScratchpadDiff *diff,
+                       const gchar    *old_text,
+                       const gchar    *new_text)
+{
+  Job *job;
+  
+  job = g_slice_new0 (Job);
+  job->old_text = g_strdup (old_text);
+  job->new_text = g_strdup (new_text);
+  
+  start_job (diff, job);
+}
+
+/*
+ * Diff a text against the lines of a file from the line number on, as 
+ * many of them as the text has, or the whole file when there is no line 
+ * number. The contents are what an editor has for the file, or NULL to 
+ * have the file read on the worker.
+ */
+void
+scratchpad_diff_source (ScratchpadDiff *diff,
+                        const gchar    *old_text,
+                        const gchar    *file_path,
+                        const gchar    *contents,
+                        gint            line_number)
+{
+  Job *job;
+  
+  job = g_slice_new0 (Job);
+  job->old_text = g_strdup (old_text);
+  job->file_path = g_strdup (file_path);
+  job->contents = g_strdup (contents);
+  job->line_number = line_number;
+  
+  start_job (diff, job);
+}
+
+void
+scratchpad_diff_cancel (ScratchpadDiff *diff)
+{
+  ScratchpadDiffPrivate *priv;
+  
+  priv = SCRATCHPAD_DIFF_GET_PRIVATE (diff);
+  
+  if (priv->cancellable == NULL)
+    return;
+  
+  g_cancellable_cancel (priv->cancellable);
+  g_object_unref (priv->cancellable);
+  priv->cancellable = NULL;
+}
+
+static void
+start_job (ScratchpadDiff *diff,
+           Job            *job)
+{
+  ScratchpadDiffPrivate *priv;
+  
+  priv = SCRATCHPAD_DIFF_GET_PRIVATE (diff);
+  
+  scratchpad_diff_cancel (diff);
+  priv->cancellable = g_cancellable_new ();
+  
+  job->diff = diff;
+  job->cancellable = g_object_ref (priv->cancellable);
+  job->result = g_slice_new0 (ScratchpadDiffResult);
+  job->result->text = g_string_new (NULL);
+  job->result->runs = g_array_new (FALSE, FALSE, sizeof (ScratchpadDiffRun));
+  
+  g_thread_pool_push (priv->pool, job, NULL);
+}
+
+/*
+ * Runs on the worker.
+ */
+static void
+run_job (Job            *job,
+         ScratchpadDiff *diff)
+{
+  ScratchpadDiffResult *result;
+  GHashTable *numbers;
+  GArray *old_lines;
+  GArray *new_lines;
+  Compare compare_data;
+  guint *a, *b;
+  gint n, m;
+  gint i, j;
+  gint64 start_time;
+  
+  result = job->result;
+  
+  if (g_cancellable_is_cancelled (job->cancellable))
+    goto done;
+  
+  start_time = SCRATCHPAD_STATS_START ();
+  
+  if (job->new_text == NULL)
+    {
+      job->new_text = read_source (job);
+      if (job->new_text == NULL)
+        goto done;
+    }
+  
+  old_lines = split_lines (job->old_text);
+  new_lines = split_lines (job->new_text);
+  n = old_lines->len;
+  m = new_lines->len;
+  
+  numbers = g_hash_table_new ((GHashFunc) line_hash, (GEqualFunc) line_equal);
+  a = number_lines (old_lines, numbers);
+  b = number_lines (new_lines, numbers);
+  g_hash_table_destroy (numbers);
+  
+  compare_data.a = a;
+  compare_data.b = b;
+  compare_data.removed = g_new0 (guint8, n + 1);
+  compare_data.added = g_new0 (guint8, m + 1);
+  compare_data.fd = g_new (gint, n + m + 3);
+  compare_data.bd = g_new (gint, n + m + 3);
+  compare_data.cancellable = job->cancellable;
+  
+  /* diagonals run from -m - 1 to n + 1 */
+  compare_data.fd += m + 1;
+  compare_data.bd += m + 1;
+  
+  compare (&compare_data, 0, n, 0, m);
+  
+  /* the removed lines of a change go ahead of the added ones */
+  for (i = 0, j = 0; (i < n || j < m) && !g_cancellable_is_cancelled (job->cancellable);)
+    {
+      if (i < n && compare_data.removed[i])
+        append_line (result, SCRATCHPAD_DIFF_REMOVED, &g_array_index (old_lines, Line, i++));
+      else if (j < m && compare_data.added[j])
+        append_line (result, SCRATCHPAD_DIFF_ADDED, &g_array_index (new_lines, Line, j++));
+      else
+        {
+          append_line (result, SCRATCHPAD_DIFF_SAME, &g_array_index (new_lines, Line, j++));
+          i++;
+        }
+    }
+  
+  g_free (compare_data.fd - m - 1);
+  g_free (compare_data.bd - m - 1);
+  g_free (compare_data.removed);
+  g_free (compare_data.added);
+  g_free (a);
+  g_free (b);
+  g_array_unref (old_lines);
+  g_array_unref (new_lines);
+  
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_DIFF, start_time);
+
+done:
+  g_idle_add ((GSourceFunc) finish_job, job);
+}
+
+/*
+ * Runs on the main loop, where the cancel happens, so the diff is still 
+ * around if the job was not cancelled.
+ */
+static gboolean
+finish_job (Job *job)
+{
+  if (!g_cancellable_is_cancelled (job->cancellable))
+    g_signal_emit (job->diff, scratchpad_diff_signals[FINISHED], 0, job->result);
+  
+  job_free (job);
+  
+  return FALSE;
+}
+
+static void
+job_free (Job *job)
+{
+  ScratchpadDiffResult *result = job->result;
+
+  g_string_free (result->text, TRUE);
+  g_array_unref (result->runs);
+  if (result->error != NULL)
+    g_error_free (result->error);
+  g_slice_free (ScratchpadDiffResult, result);
+  
+  g_object_unref (job->cancellable);
+  g_free (job->old_text);
+  g_free (job->new_text);
+  g_free (job->file_path);
+  g_free (job->contents);
+  g_slice_free (Job, job);
+}
+
+/*
+ * The lines of the file that the old text was taken from, or NULL with 
+ * the error set in the result.
+ */
+static gchar*
+read_source (Job *job)
+{
+  gchar *contents;
+  const gchar *start;
+  const gchar *end;
+  const gchar *p;
+  gchar *text;
+  gint lines;
+  gint line;
+
+  if (job->contents != NULL)
+    {
+      contents = job->contents;
+      job->contents = NULL;
+    }
+  else if (!g_file_get_contents (job->file_path, &contents, NULL, &job->result->error))
+    {
+      return NULL;
+    }
+  
+  if (job->line_number <= 0)
+    return contents;
+  
+  lines = 1;
+  for (p = job->old_text; *p != '\0'; p++)
+    {
+      if (*p == '\n' && p[1] != '\0')
+        lines++;
+    }
+  
+  start = contents;
+  for (line = 1; line < job->line_number && *start != '\0'; line++)
+    {
+      start = strchr (start, '\n');
+      start = start != NULL ? start + 1 : contents + strlen (contents);
+    }
+  
+  end = start;
+  for (line = 0; line < lines && *end != '\0'; line++)
+    {
+      end = strchr (end, '\n');
+      end = end != NULL ? end + 1 : start + strlen (start);
+    }
+  
+  text = g_strndup (start, end - start);
+  g_free (contents);
+  
+  return text;
+}
+
+/*
+ * The lines point into the text. A newline at the very end does not 
+ * start another line.
+ */
+static GArray*
+split_lines (const gchar *text)
+{
+  GArray *lines;
+  const gchar *p;
+  
+  lines = g_array_new (FALSE, FALSE, sizeof (Line));
+  
+  for (p = text; *p != '\0';)
+    {
+      Line line;
+      const gchar *end;
+      
+      end = strchr (p, '\n');
+      if (end == NULL)
+        end = p + strlen (p);
+      
+      line.text = p;
+      line.length = end - p;
+      g_array_append_val (lines, line);
+      
+      p = *end == '\n' ? end + 1 : end;
+    }
+  
+  return lines;
+}
+
+/*
+ * Give every line the number of the first line with the same text, on 
+ * either side, so that comparing lines is comparing numbers.
+ */
+static guint*
+number_lines (GArray     *lines,
+              GHashTable *numbers)
+{
+  guint *result;
+  guint i;
+  
+  result = g_new (guint, lines->len + 1);
+  
+  for (i = 0; i < lines->len; i++)
+    {
+      Line *line = &g_array_index (lines, Line, i);
+      gpointer number;
+      
+      if (!g_hash_table_lookup_extended (numbers, line, NULL, &number))
+        {
+          number = GUINT_TO_POINTER (g_hash_table_size (numbers));
+          g_hash_table_insert (numbers, line, number);
+        }
+      
+      result[i] = GPOINTER_TO_UINT (number);
+    }
+  
+  return result;
+}
+
+static guint
+line_hash (const Line *line)
+{
+  guint hash = 5381;
+  guint i;
+  
+  for (i = 0; i < line->length; i++)
+    hash = (hash << 5) + hash + (guchar) line->text[i];
+  
+  return hash;
+}
+
+static gboolean
+line_equal (const Line *line1,
+            const Line *line2)
+{
+  return line1->length == line2->length && 
+         memcmp (line1->text, line2->text, line1->length) == 0;
+}
+
+/*
+ * Mark the lines that have to go from the one side and the ones that 
+ * have to come in from the other to get between the two ranges.
+ */
+static void
+compare (Compare *compare_data,
+         gint     xoff,
+         gint     xlim,
+         gint     yoff,
+         gint     ylim)
+{
+  const guint *a = compare_data->a;
+  const guint *b = compare_data->b;
+  gint xmid, ymid;
+  
+  while (xoff < xlim && yoff < ylim && a[xoff] == b[yoff])
+    {
+      xoff++;
+      yoff++;
+    }
+  
+  while (xlim > xoff && ylim > yoff && a[xlim - 1] == b[ylim - 1])
+    {
+      xlim--;
+      ylim--;
+    }
+  
+  if (xoff == xlim)
+    {
+      while (yoff < ylim)
+        compare_data->added[yoff++] = TRUE;
+      return;
+    }
+  
+  if (yoff == ylim)
+    {
+      while (xoff < xlim)
+        compare_data->removed[xoff++] = TRUE;
+      return;
+    }
+  
+  if (g_cancellable_is_cancelled (compare_data->cancellable))
+    return;
+  
+  find_middle (compare_data, xoff, xlim, yoff, ylim, &xmid, &ymid);
+  compare (compare_data, xoff, xmid, yoff, ymid);
+  compare (compare_data, xmid, xlim, ymid, ylim);
+}
+
+/*
+ * Go forward from the start and back from the end one edit at a time, 
+ * along every diagonal x - y that can be reached, until the two paths 
+ * meet. Where they meet splits the shortest path into halves.
+ */
+static void
+find_middle (Compare *compare_data,
+             gint     xoff,
+             gint     xlim,
+             gint     yoff,
+             gint     ylim,
+             gint    *xmid,
+             gint    *ymid)
+{
+  const guint *a = compare_data->a;
+  const guint *b = compare_data->b;
+  gint *fd = compare_data->fd;
+  gint *bd = compare_data->bd;
+  gint dmin = xoff - ylim;
+  gint dmax = xlim - yoff;
+  gint fmid = xoff - yoff;
+  gint bmid = xlim - ylim;
+  gint fmin = fmid, fmax = fmid;
+  gint bmin = bmid, bmax = bmid;
+  gboolean odd = (fmid - bmid) & 1;
+  
+  fd[fmid] = xoff;
+  bd[bmid] = xlim;
+  
+  for (;;)
+    {
+      gint d;
+      
+      if (fmin > dmin)
+        fd[--fmin - 1] = -1;
+      else
+        ++fmin;
+      
+      if (fmax < dmax)
+        fd[++fmax + 1] = -1;
+      else
+        --fmax;
+      
+      for (d = fmax; d >= fmin; d -= 2)
+        {
+          gint x, y;
+          
+          x = fd[d - 1] >= fd[d + 1] ? fd[d - 1] + 1 : fd[d + 1];
+          y = x - d;
+          while (x < xlim && y < ylim && a[x] == b[y])
+            {
+              x++;
+              y++;
+            }
+          
+          fd[d] = x;
+          if (odd && bmin <= d && d <= bmax && bd[d] <= x)
+            {
+              *xmid = x;
+              *ymid = y;
+              return;
+            }
+        }
+      
+      if (bmin > dmin)
+        bd[--bmin - 1] = G_MAXINT;
+      else
+        ++bmin;
+      
+      if (bmax < dmax)
+        bd[++bmax + 1] = G_MAXINT;
+      else
+        --bmax;
+      
+      for (d = bmax; d >= bmin; d -= 2)
+        {
+          gint x, y;
+          
+          x = bd[d - 1] < bd[d + 1] ? bd[d - 1] : bd[d + 1] - 1;
+          y = x - d;
+          while (x > xoff && y > yoff && a[x - 1] == b[y - 1])
+            {
+              x--;
+              y--;
+            }
+          
+          bd[d] = x;
+          if (!odd && fmin <= d && d <= fmax && x <= fd[d])
+            {
+              *xmid = x;
+              *ymid = y;
+              return;
+            }
+        }
+    }
+}
+
+static void
+append_line (ScratchpadDiffResult *result,
+             ScratchpadDiffKind    kind,
+             const Line           *line)
+{
+  ScratchpadDiffRun *last = NULL;
+  guint number = 0;
+  
+  if (result->runs->len > 0)
+    {
+      last = &g_array_index (result->runs, ScratchpadDiffRun, result->runs->len - 1);
+      number = last->line + last->count;
+    }
+  
+  if (last != NULL && last->kind == kind)
+    {
+      last->count++;
+    }
+  else
+    {
+      ScratchpadDiffRun run;
+      run.kind = kind;
+      run.line = number;
+      run.count = 1;
+      g_array_append_val (result->runs, run);
+    }
+  
+  switch (kind)
+    {
+    case SCRATCHPAD_DIFF_SAME:
+      g_string_append (result->text, "  ");
+      break;
+    case SCRATCHPAD_DIFF_REMOVED:
+      g_string_append (result->text, "- ");
+      result->removed++;
+      break;
+    case SCRATCHPAD_DIFF_ADDED:
+      g_string_append (result->text, "+ ");
+      result->added++;
+      break;
+    }
+  
+  g_string_append_len (result->text, line->text, line->length);
+  g_string_append_c (result->text, '\n');
+}
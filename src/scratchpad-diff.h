@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_DIFF_H__
+#define	__SCRATCHPAD_DIFF_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_DIFF_TYPE            (scratchpad_diff_get_type ())
+#define SCRATCHPAD_DIFF(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_DIFF_TYPE, ScratchpadDiff))
+#define SCRATCHPAD_DIFF_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_DIFF_TYPE, ScratchpadDiffClass))
+#define IS_SCRATCHPAD_DIFF(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_DIFF_TYPE))
+#define IS_SCRATCHPAD_DIFF_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_DIFF_TYPE))
+
+typedef struct _ScratchpadDiff ScratchpadDiff;
+typedef struct _ScratchpadDiffClass ScratchpadDiffClass;
+
+typedef enum
+{
+  SCRATCHPAD_DIFF_SAME,
+  SCRATCHPAD_DIFF_REMOVED,
+  SCRATCHPAD_DIFF_ADDED
+} ScratchpadDiffKind;
+
+/* a run of lines of the result that are all of the one kind */
+typedef struct
+{
+  ScratchpadDiffKind kind;
+  guint              line;
+  guint              count;
+} ScratchpadDiffRun;
+
+typedef struct
+{
+  GString *text;
+  GArray  *runs;
+  guint    added;
+  guint    removed;
+  GError  *error;
+} ScratchpadDiffResult;
+
+struct _ScratchpadDiff
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadDiffClass
+{
+  GObjectClass parent_class;
+
+  void (*finished) (ScratchpadDiff       *diff,
+                    ScratchpadDiffResult *result);
+};
+
+GType scratchpad_diff_get_type (void) G_GNUC_CONST;
+
+ScratchpadDiff*  scratchpad_diff_new          (void);
+
+void             scratchpad_diff_texts        (ScratchpadDiff *diff,
+                                               const gchar    *old_text,
+                                               const gchar    *new_text);
+void             scratchpad_diff_source       (ScratchpadDiff *diff,
+                                               const gchar    *old_text,
+                                               const gchar    *file_path,
+                                               const gchar    *contents,
+                                               gint            line_number);
+void             scratchpad_diff_cancel       (ScratchpadDiff *diff);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_DIFF_H__ */
@@ -16,25 +16,103 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <codeslayer/codeslayer-utils.h>
 #include "scratchpad-engine.h"
-#include "scratchpad-pane.h"
+#include "scratchpad-pads.h"
+#include "scratchpad-stats.h"
+#include "scratchpad-share.h"
+
+/*
+ * Captures are applied to the pane this many batches at a time from an 
+ * idle callback so that a burst of them does not hold up the main loop.
+ * A single copy is a batch of one.
+ */
+#define CAPTURE_BATCH 16
 
 typedef struct
 {
-  gchar         *file_path;
-  unsigned long  line_number;
-} Tag;
+  const gchar       *file_path;
+  gint               line_number;
+  gchar             *text;
+  gint64             timestamp;
+  guint              record;
+  gboolean           shared;
+  ScratchpadJournal *journal;
+} Capture;
 
+/*
+ * Copies made with auto capture on are held until there has been none 
+ * for the delay, so that a burst of them goes to the pane as one batch. 
+ * A long burst is let through every so often, or once it gets this big.
+ */
+#define AUTO_CAPTURE_DELAY 300
+#define AUTO_CAPTURE_WAIT 2000
+#define AUTO_CAPTURE_BATCH 64
+
+/*
+ * Imported regions go to the capture worker this many at a time.
+ */
+#define IMPORT_BATCH 16
+
+typedef struct
+{
+  gchar             *file_name;
+  ScratchpadJournal *journal;
+} Import;
+
+typedef struct
+{
+  const gchar *file_path;
+  gint         start;
+  gint         end;
+} Region;
 
 static void scratchpad_engine_class_init  (ScratchpadEngineClass *klass);
 static void scratchpad_engine_init        (ScratchpadEngine      *engine);
 static void scratchpad_engine_finalize    (ScratchpadEngine      *engine);
 
 static void copy_action                   (ScratchpadEngine      *engine);
-static gchar* get_header                  (ScratchpadEngine      *engine, 
-                                           gint                   line_number);
+static Capture* capture_new               (CodeSlayerDocument    *document,
+                                           GtkTextIter           *start,
+                                           GtkTextIter           *end,
+                                           ScratchpadJournal     *journal);
+static Capture* capture_new_with_text     (const gchar           *file_path,
+                                           gint                   line_number,
+                                           gchar                 *text,
+                                           ScratchpadJournal     *journal);
+static GPtrArray* batch_new               (void);
+static void push_batch                    (ScratchpadEngine      *engine,
+                                           GPtrArray             *batch);
+static void process_batch                 (GPtrArray             *batch,
+                                           ScratchpadEngine      *engine);
+static gboolean apply_captures            (ScratchpadEngine      *engine);
+static void normalize_text                (gchar                 *text);
+static void capture_free                  (Capture               *capture);
+static ScratchpadJournal* get_journal     (ScratchpadEngine      *engine);
+static void process_import                (Import                *import,
+                                           ScratchpadEngine      *engine);
+static GArray* parse_regions              (const gchar           *file_name);
+static const gchar* parse_number          (const gchar           *start,
+                                           const gchar           *line_end,
+                                           gint                  *number);
+static gint region_compare                (Region                *region1,
+                                           Region                *region2);
+static GPtrArray* import_file             (ScratchpadEngine      *engine,
+                                           Import                *import,
+                                           Region                *regions,
+                                           guint                  count,
+                                           GPtrArray             *batch,
+                                           GPtrArray             *unreadable);
+static void import_free                   (Import                *import);
+static void received_action               (ScratchpadEngine      *engine,
+                                           ScratchpadSnippet     *snippet);
+static void owner_change_action           (ScratchpadEngine      *engine);
+static gboolean is_pending                (ScratchpadEngine      *engine,
+                                           Capture               *capture);
+static gboolean flush_action              (ScratchpadEngine      *engine);
+static void flush_pending                 (ScratchpadEngine      *engine);
                                                    
 #define SCRATCHPAD_ENGINE_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_ENGINE_TYPE, ScratchpadEnginePrivate))
@@ -43,9 +121,22 @@ typedef struct _ScratchpadEnginePrivate ScratchpadEnginePrivate;
 
 struct _ScratchpadEnginePrivate
 {
-  CodeSlayer *codeslayer;
-  GtkWidget  *menu;
-  GtkWidget  *pane;
+  CodeSlayer      *codeslayer;
+  GtkWidget       *menu;
+  GtkWidget       *pads;
+  ScratchpadShare *share;
+  gulong           received_id;
+  GtkClipboard    *clipboard;
+  gulong           owner_change_id;
+  GPtrArray       *pending;
+  gint64           pending_since;
+  guint            flush_id;
+  GThreadPool     *pool;
+  GThreadPool     *importer;
+  gint             cancelled;
+  GAsyncQueue     *captures;
+  gint             scheduled;
+  guint            apply_id;
 };
 
 G_DEFINE_TYPE (ScratchpadEngine, scratchpad_engine, G_TYPE_OBJECT)
@@ -58,19 +149,65 @@ scratchpad_engine_class_init (ScratchpadEngineClass *klass)
   g_type_class_add_private (klass, sizeof (ScratchpadEnginePrivate));
 }
 
+/*
+ * A single worker keeps the captures in the order they were made.
+ */
 static void
-scratchpad_engine_init (ScratchpadEngine *engine) {}
+scratchpad_engine_init (ScratchpadEngine *engine) 
+{
+  ScratchpadEnginePrivate *priv;
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  priv->pool = g_thread_pool_new ((GFunc) process_batch, engine, 1, FALSE, NULL);
+  priv->importer = g_thread_pool_new ((GFunc) process_import, engine, 1, FALSE, NULL);
+  priv->cancelled = 0;
+  priv->captures = g_async_queue_new_full ((GDestroyNotify) g_ptr_array_unref);
+  priv->scheduled = 0;
+  priv->apply_id = 0;
+  priv->share = NULL;
+  priv->clipboard = NULL;
+  priv->owner_change_id = 0;
+  priv->pending = NULL;
+  priv->flush_id = 0;
+}
 
+/*
+ * Whatever is still queued has already been written to the journal, so
+ * it comes back the next time the pad is restored.
+ */
 static void
 scratchpad_engine_finalize (ScratchpadEngine *engine)
 {
+  ScratchpadEnginePrivate *priv;
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+
+  /* copies still being held are journaled along with the rest */
+  scratchpad_engine_set_auto_capture (engine, FALSE);
+  
+  /* an import that is part way through stops at the next region */
+  g_atomic_int_set (&priv->cancelled, 1);
+  g_thread_pool_free (priv->importer, TRUE, TRUE);
+  
+  g_thread_pool_free (priv->pool, FALSE, TRUE);
+  
+  if (priv->share != NULL)
+    {
+      g_signal_handler_disconnect (priv->share, priv->received_id);
+      g_object_unref (priv->share);
+    }
+  
+  if (g_atomic_int_get (&priv->scheduled))
+    g_source_remove (priv->apply_id);
+  
+  g_async_queue_unref (priv->captures);
+
   G_OBJECT_CLASS (scratchpad_engine_parent_class)->finalize (G_OBJECT(engine));
 }
 
 ScratchpadEngine*
 scratchpad_engine_new (CodeSlayer *codeslayer,
                        GtkWidget  *menu, 
-                       GtkWidget  *pane)
+                       GtkWidget  *pads)
 {
   ScratchpadEnginePrivate *priv;
   ScratchpadEngine *engine;
@@ -80,7 +217,7 @@ scratchpad_engine_new (CodeSlayer *codeslayer,
 
   priv->codeslayer = codeslayer;
   priv->menu = menu;
-  priv->pane = pane;
+  priv->pads = pads;
 
   g_signal_connect_swapped (G_OBJECT (menu), "copy",
                             G_CALLBACK (copy_action), engine);
@@ -93,49 +230,765 @@ copy_action (ScratchpadEngine *engine)
 {
   ScratchpadEnginePrivate *priv;
   CodeSlayerEditor *editor;
+  CodeSlayerDocument *document;
   GtkTextBuffer *buffer;
   GtkTextIter start, end;
-  gint line_number;
-  gchar *header;              
-  gchar *text;
+  Capture *capture;
+  GPtrArray *batch;
+  gint64 start_time;
   
   priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
   
   editor = codeslayer_get_active_editor (priv->codeslayer);
+  if (editor == NULL)
+    return;
   
+  document = codeslayer_get_active_editor_document (priv->codeslayer);
   buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (editor));
   gtk_text_buffer_get_selection_bounds (buffer, &start, &end);
-  text = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
   
-  line_number = gtk_text_iter_get_line (&start);
+  start_time = SCRATCHPAD_STATS_START ();
+  capture = capture_new (document, &start, &end, get_journal (engine));
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_EXTRACT, start_time);
+  if (capture == NULL)
+    return;
   
-  header = get_header (engine, line_number);
+  batch = batch_new ();
+  g_ptr_array_add (batch, capture);
+  push_batch (engine, batch);
+}
+
+/*
+ * Capture a list of ScratchpadRange in one go. The text is taken out of the documents 
+ * right away, and the snippets show up in the pane together as a single 
+ * user action rather than one at a time.
+ */
+void
+scratchpad_engine_capture_ranges (ScratchpadEngine *engine,
+                                  GList            *ranges)
+{
+  ScratchpadJournal *journal;
+  GPtrArray *batch;
+  GList *list;
   
-  scratchpad_pane_add_text (SCRATCHPAD_PANE (priv->pane), header, text);
+  journal = get_journal (engine);
+  batch = batch_new ();
   
-  codeslayer_show_side_pane (priv->codeslayer, GTK_WIDGET (priv->pane));
+  for (list = ranges; list != NULL; list = g_list_next (list))
+    {
+      ScratchpadRange *range = list->data;
+      Capture *capture;
+      
+      capture = capture_new (range->document, &range->start, &range->end, journal);
+      if (capture != NULL)
+        g_ptr_array_add (batch, capture);
+    }
   
-  if (text != NULL)
-    g_free (text);
-    
-  g_free (header);      
+  if (batch->len == 0)
+    {
+      g_ptr_array_unref (batch);
+      return;
+    }
+  
+  push_batch (engine, batch);
 }
 
-static gchar*
-get_header (ScratchpadEngine *engine, 
-            gint              line_number)
+/*
+ * Publish every capture to the other instances sharing the pad, and take 
+ * in theirs. This has to be done before anything is captured, the worker
+ * reads the share without a lock.
+ */
+void
+scratchpad_engine_set_share (ScratchpadEngine *engine,
+                             ScratchpadShare  *share)
 {
   ScratchpadEnginePrivate *priv;
-  CodeSlayerDocument *document;
-  const gchar *file_path;
-  gchar *header;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  priv->share = g_object_ref (share);
+  priv->received_id = g_signal_connect_swapped (G_OBJECT (share), "received",
+                                                G_CALLBACK (received_action), engine);
+}
 
+/*
+ * Record every copy made in an editor. The copy is noticed through the 
+ * clipboard changing hands while an editor has the focus, and the text 
+ * and location are taken from its selection the way the menu does it.
+ */
+void
+scratchpad_engine_set_auto_capture (ScratchpadEngine *engine,
+                                    gboolean          auto_capture)
+{
+  ScratchpadEnginePrivate *priv;
+  
   priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
   
+  if (auto_capture && priv->owner_change_id == 0)
+    {
+      priv->clipboard = gtk_clipboard_get (GDK_SELECTION_CLIPBOARD);
+      priv->owner_change_id = g_signal_connect_swapped (G_OBJECT (priv->clipboard), "owner-change",
+                                                        G_CALLBACK (owner_change_action), engine);
+    }
+  else if (!auto_capture && priv->owner_change_id != 0)
+    {
+      g_signal_handler_disconnect (priv->clipboard, priv->owner_change_id);
+      priv->owner_change_id = 0;
+      flush_pending (engine);
+    }
+}
+
+/*
+ * Nothing but taking the text out happens here, the editor is waiting. 
+ * The side pane is not brought up either, it would take the focus away 
+ * from the editor with every copy.
+ */
+static void
+owner_change_action (ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  CodeSlayerEditor *editor;
+  CodeSlayerDocument *document;
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  Capture *capture;
+  gint64 now;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  editor = codeslayer_get_active_editor (priv->codeslayer);
+  if (editor == NULL || !gtk_widget_has_focus (GTK_WIDGET (editor)))
+    return;
+  
   document = codeslayer_get_active_editor_document (priv->codeslayer);
-  file_path = codeslayer_document_get_file_path (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (editor));
+  if (!gtk_text_buffer_get_selection_bounds (buffer, &start, &end))
+    return;
+  
+  capture = capture_new (document, &start, &end, get_journal (engine));
+  if (capture == NULL)
+    return;
+  
+  /* a macro copying the same thing over and over */
+  if (is_pending (engine, capture))
+    {
+      capture_free (capture);
+      return;
+    }
+  
+  now = g_get_monotonic_time ();
+  
+  if (priv->pending == NULL)
+    {
+      priv->pending = batch_new ();
+      priv->pending_since = now;
+    }
+  
+  g_ptr_array_add (priv->pending, capture);
+  
+  if (priv->pending->len >= AUTO_CAPTURE_BATCH || 
+      now - priv->pending_since >= AUTO_CAPTURE_WAIT * 1000)
+    {
+      flush_pending (engine);
+      return;
+    }
+  
+  if (priv->flush_id != 0)
+    g_source_remove (priv->flush_id);
+  priv->flush_id = g_timeout_add (AUTO_CAPTURE_DELAY, (GSourceFunc) flush_action, engine);
+}
+
+static gboolean
+is_pending (ScratchpadEngine *engine,
+            Capture          *capture)
+{
+  ScratchpadEnginePrivate *priv;
+  guint i;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  if (priv->pending == NULL)
+    return FALSE;
+  
+  for (i = 0; i < priv->pending->len; i++)
+    {
+      Capture *pending = g_ptr_array_index (priv->pending, i);
+      if (pending->file_path == capture->file_path && 
+          pending->line_number == capture->line_number &&
+          strcmp (pending->text, capture->text) == 0)
+        return TRUE;
+    }
+  
+  return FALSE;
+}
+
+static gboolean
+flush_action (ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  priv->flush_id = 0;
+  flush_pending (engine);
+  return FALSE;
+}
+
+/*
+ * The held copies go to the worker as one batch, and from there into the 
+ * pane as one user action.
+ */
+static void
+flush_pending (ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  if (priv->flush_id != 0)
+    {
+      g_source_remove (priv->flush_id);
+      priv->flush_id = 0;
+    }
+  
+  if (priv->pending == NULL)
+    return;
+  
+  g_thread_pool_push (priv->pool, priv->pending, NULL);
+  priv->pending = NULL;
+}
 
-  header = g_strdup_printf ("%s:%d", file_path, ++line_number);
+/*
+ * A snippet from another instance goes through the worker like any other 
+ * capture so that it is journaled to the active pad.
+ */
+static void
+received_action (ScratchpadEngine  *engine,
+                 ScratchpadSnippet *snippet)
+{
+  ScratchpadEnginePrivate *priv;
+  Capture *capture;
+  GPtrArray *batch;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  capture = capture_new_with_text (snippet->file_path, snippet->line_number, 
+                                   g_strdup (snippet->text), get_journal (engine));
+  capture->timestamp = snippet->timestamp;
+  capture->shared = TRUE;
+  
+  batch = batch_new ();
+  g_ptr_array_add (batch, capture);
+  g_thread_pool_push (priv->pool, batch, NULL);
+}
 
-  return header;
+/*
+ * Import the regions listed in a file, one per line, in the form of 
+ * path:line or path:start-end. Anything after the line number is ignored,
+ * so the output of a compiler or a test run can be used as is. Relative 
+ * paths are taken from the directory the list is in. The files are read 
+ * off the main loop and the snippets come into the pane in batches.
+ */
+void
+scratchpad_engine_import (ScratchpadEngine *engine,
+                          const gchar      *file_name)
+{
+  ScratchpadEnginePrivate *priv;
+  ScratchpadJournal *journal;
+  Import *import;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  journal = get_journal (engine);
+
+  import = g_slice_new (Import);
+  import->file_name = g_strdup (file_name);
+  import->journal = journal != NULL ? g_object_ref (journal) : NULL;
+  
+  g_thread_pool_push (priv->importer, import, NULL);
+  
+  codeslayer_show_side_pane (priv->codeslayer, priv->pads);
+}
+
+/*
+ * The text between the iters is the only copy of it, the store takes it 
+ * over as is. The file path belongs to the document and is interned here 
+ * so that the capture can outlive it.
+ */
+static Capture*
+capture_new (CodeSlayerDocument *document,
+             GtkTextIter        *start,
+             GtkTextIter        *end,
+             ScratchpadJournal  *journal)
+{
+  gchar *text;
+  
+  text = gtk_text_iter_get_text (start, end);
+  if (text == NULL)
+    return NULL;
+
+  return capture_new_with_text (codeslayer_document_get_file_path (document), 
+                                gtk_text_iter_get_line (start) + 1, text, journal);
+}
+
+static Capture*
+capture_new_with_text (const gchar       *file_path,
+                       gint               line_number,
+                       gchar             *text,
+                       ScratchpadJournal *journal)
+{
+  Capture *capture;
+
+  capture = g_slice_new (Capture);
+  capture->file_path = g_intern_string (file_path);
+  capture->line_number = line_number;
+  capture->text = text;
+  capture->timestamp = g_get_real_time ();
+  capture->record = G_MAXUINT;
+  capture->shared = FALSE;
+  capture->journal = journal != NULL ? g_object_ref (journal) : NULL;
+  
+  return capture;
+}
+
+static GPtrArray*
+batch_new (void)
+{
+  return g_ptr_array_new_with_free_func ((GDestroyNotify) capture_free);
+}
+
+static void
+push_batch (ScratchpadEngine *engine,
+            GPtrArray        *batch)
+{
+  ScratchpadEnginePrivate *priv;
+  gint64 start_time;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  g_thread_pool_push (priv->pool, batch, NULL);
+  
+  start_time = SCRATCHPAD_STATS_START ();
+  codeslayer_show_side_pane (priv->codeslayer, priv->pads);
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_SHOW_PANE, start_time);
+}
+
+/*
+ * Runs on the worker thread. The captures are made ready for the pane and 
+ * written to the journal, then queued for the main loop to apply.
+ */
+static void
+process_batch (GPtrArray        *batch,
+               ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  gint64 start_time;
+  guint i;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  for (i = 0; i < batch->len; i++)
+    {
+      Capture *capture = g_ptr_array_index (batch, i);
+      ScratchpadSnippet snippet;
+      
+      normalize_text (capture->text);
+
+      snippet.file_path = capture->file_path;
+      snippet.line_number = capture->line_number;
+      snippet.text = capture->text;
+      snippet.timestamp = capture->timestamp;
+
+      if (capture->journal != NULL)
+        {
+          start_time = SCRATCHPAD_STATS_START ();
+          capture->record = scratchpad_journal_append (capture->journal, &snippet);
+          SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_JOURNAL, start_time);
+        }
+      
+      /* what came from another instance is not sent back out */
+      if (priv->share != NULL && !capture->shared)
+        scratchpad_share_publish (priv->share, &snippet);
+    }
+  
+  g_async_queue_push (priv->captures, batch);
+  
+  if (g_atomic_int_compare_and_exchange (&priv->scheduled, 0, 1))
+    priv->apply_id = g_idle_add ((GSourceFunc) apply_captures, engine);
+}
+
+/*
+ * Runs on the import thread. The regions are sorted so that every file is 
+ * mapped once and read from the top down a single time.
+ */
+static void
+process_import (Import           *import,
+                ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  GArray *regions;
+  GPtrArray *batch;
+  GPtrArray *unreadable;
+  gint64 start_time;
+  guint start;
+  guint i;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  start_time = SCRATCHPAD_STATS_START ();
+  
+  regions = parse_regions (import->file_name);
+  if (regions == NULL)
+    {
+      import_free (import);
+      return;
+    }
+  
+  g_array_sort (regions, (GCompareFunc) region_compare);
+  
+  batch = batch_new ();
+  unreadable = g_ptr_array_new ();
+  
+  for (start = 0, i = 1; i <= regions->len; i++)
+    {
+      Region *region = &g_array_index (regions, Region, start);
+
+      if (i < regions->len && g_array_index (regions, Region, i).file_path == region->file_path)
+        continue;
+      
+      if (g_atomic_int_get (&priv->cancelled))
+        break;
+
+      batch = import_file (engine, import, region, i - start, batch, unreadable);
+      start = i;
+    }
+  
+  if (batch->len > 0)
+    g_thread_pool_push (priv->pool, batch, NULL);
+  else
+    g_ptr_array_unref (batch);
+  
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_IMPORT, start_time);
+  
+  /* one warning for the whole import rather than one per file */
+  if (unreadable->len == 1)
+    g_warning ("scratchpad import: can not read %s", 
+               (const gchar*) g_ptr_array_index (unreadable, 0));
+  else if (unreadable->len > 1)
+    g_warning ("scratchpad import: can not read %s and %u other files", 
+               (const gchar*) g_ptr_array_index (unreadable, 0), unreadable->len - 1);
+
+  g_ptr_array_unref (unreadable);
+  g_array_free (regions, TRUE);
+  import_free (import);
+}
+
+static GArray*
+parse_regions (const gchar *file_name)
+{
+  GMappedFile *mapped_file;
+  GError *error = NULL;
+  GArray *regions;
+  gchar *directory;
+  const gchar *contents;
+  const gchar *end;
+  
+  mapped_file = g_mapped_file_new (file_name, FALSE, &error);
+  if (mapped_file == NULL)
+    {
+      g_warning ("scratchpad import: %s", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+  
+  regions = g_array_new (FALSE, FALSE, sizeof (Region));
+  directory = g_path_get_dirname (file_name);
+  
+  contents = g_mapped_file_get_contents (mapped_file);
+  end = contents + g_mapped_file_get_length (mapped_file);
+  
+  while (contents < end)
+    {
+      const gchar *line_end;
+      const gchar *colon;
+      Region region;
+      gchar *file_path;
+      const gchar *number_end;
+      
+      line_end = memchr (contents, '\n', end - contents);
+      if (line_end == NULL)
+        line_end = end;
+      
+      /* the path runs up to the first colon that has a number after it */
+      for (colon = contents; colon < line_end; colon++)
+        if (*colon == ':' && colon + 1 < line_end && g_ascii_isdigit (colon[1]))
+          break;
+      
+      if (colon < line_end && colon > contents)
+        {
+          number_end = parse_number (colon + 1, line_end, &region.start);
+          region.end = region.start;
+          if (number_end < line_end && *number_end == '-' && 
+              number_end + 1 < line_end && g_ascii_isdigit (number_end[1]))
+            parse_number (number_end + 1, line_end, &region.end);
+          
+          file_path = g_strndup (contents, colon - contents);
+          if (!g_path_is_absolute (file_path))
+            {
+              gchar *relative = file_path;
+              file_path = g_build_filename (directory, relative, NULL);
+              g_free (relative);
+            }
+          
+          region.file_path = g_intern_string (file_path);
+          g_free (file_path);
+          
+          if (region.start > 0 && region.end >= region.start)
+            g_array_append_val (regions, region);
+        }
+      
+      contents = line_end + 1;
+    }
+  
+  g_free (directory);
+  g_mapped_file_unref (mapped_file);
+  
+  return regions;
+}
+
+/*
+ * The digits at the start, up to the end of the line. The mapping is not 
+ * terminated so they are copied out to be converted. A number too big to
+ * be a line comes out as 0, which no region starts at. Returns where the
+ * digits end.
+ */
+static const gchar*
+parse_number (const gchar *start,
+              const gchar *line_end,
+              gint        *number)
+{
+  const gchar *digits_end;
+  gchar *field;
+  gint64 value;
+  
+  digits_end = start;
+  while (digits_end < line_end && g_ascii_isdigit (*digits_end))
+    digits_end++;
+  
+  field = g_strndup (start, digits_end - start);
+  value = g_ascii_strtoll (field, NULL, 10);
+  g_free (field);
+  
+  *number = value <= G_MAXINT ? (gint) value : 0;
+  
+  return digits_end;
+}
+
+/*
+ * The paths are interned so they only need to be grouped, not ordered by 
+ * name.
+ */
+static gint
+region_compare (Region *region1,
+                Region *region2)
+{
+  if (region1->file_path != region2->file_path)
+    return region1->file_path < region2->file_path ? -1 : 1;
+  return region1->start - region2->start;
+}
+
+/*
+ * The regions are all from the one file and in order of their first line.
+ * Regions can overlap, so the next one is looked for from where the last 
+ * one started rather than where it ended. Full batches are handed to the 
+ * capture worker as they fill up and the one still filling is returned.
+ * A file that can not be read is added to the unreadable ones.
+ */
+static GPtrArray*
+import_file (ScratchpadEngine *engine,
+             Import           *import,
+             Region           *regions,
+             guint             count,
+             GPtrArray        *batch,
+             GPtrArray        *unreadable)
+{
+  ScratchpadEnginePrivate *priv;
+  GMappedFile *mapped_file;
+  const gchar *contents;
+  const gchar *end;
+  const gchar *start;
+  gint line;
+  guint i;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+
+  mapped_file = g_mapped_file_new (regions[0].file_path, FALSE, NULL);
+  if (mapped_file == NULL)
+    {
+      g_ptr_array_add (unreadable, (gpointer) regions[0].file_path);
+      return batch;
+    }
+  
+  contents = g_mapped_file_get_contents (mapped_file);
+  end = contents + g_mapped_file_get_length (mapped_file);
+  
+  start = contents;
+  line = 1;
+  
+  for (i = 0; i < count && contents != NULL; i++)
+    {
+      const gchar *stop;
+      gint stop_line;
+      
+      while (line < regions[i].start && start < end)
+        {
+          start = memchr (start, '\n', end - start);
+          start = start != NULL ? start + 1 : end;
+          line++;
+        }
+      
+      if (start >= end)
+        break;
+      
+      stop = start;
+      for (stop_line = line; stop_line <= regions[i].end && stop < end; stop_line++)
+        {
+          stop = memchr (stop, '\n', end - stop);
+          stop = stop != NULL ? stop + 1 : end;
+        }
+
+      g_ptr_array_add (batch, capture_new_with_text (regions[i].file_path, regions[i].start, 
+                                                     g_strndup (start, stop - start), 
+                                                     import->journal));
+      
+      if (batch->len == IMPORT_BATCH)
+        {
+          g_thread_pool_push (priv->pool, batch, NULL);
+          batch = batch_new ();
+        }
+    }
+  
+  g_mapped_file_unref (mapped_file);
+  
+  return batch;
+}
+
+static void
+import_free (Import *import)
+{
+  if (import->journal != NULL)
+    g_object_unref (import->journal);
+  g_free (import->file_name);
+  g_slice_free (Import, import);
+}
+
+/*
+ * Runs on the main loop and hands the batches to the active pad. A capture 
+ * that was journaled for a pad that has since been switched away from 
+ * stays in that journal and shows up when the pad is next switched to.
+ */
+static gboolean
+apply_captures (ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  ScratchpadPane *pane;
+  ScratchpadJournal *journal;
+  GPtrArray *batch;
+  guint i;
+  
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  
+  pane = scratchpad_pads_get_pane (SCRATCHPAD_PADS (priv->pads));
+  journal = scratchpad_store_get_journal (scratchpad_pane_get_store (pane));
+  
+  scratchpad_pane_begin_batch (pane);
+  
+  for (i = 0; i < CAPTURE_BATCH; i++)
+    {
+      guint j;
+
+      batch = g_async_queue_try_pop (priv->captures);
+      if (batch == NULL)
+        break;
+
+      for (j = 0; j < batch->len; j++)
+        {
+          Capture *capture = g_ptr_array_index (batch, j);
+          ScratchpadSnippet *snippet;
+          
+          if (capture->journal != journal)
+            continue;
+
+          snippet = scratchpad_pane_add_snippet (pane, capture->file_path, 
+                                                 capture->line_number, capture->text);
+          snippet->timestamp = capture->timestamp;
+          
+          /* a repeat keeps the record it already has */
+          if (snippet->record == G_MAXUINT)
+            snippet->record = capture->record;
+          else if (capture->record != G_MAXUINT)
+            scratchpad_journal_remove (capture->journal, capture->record);
+
+          /* the pane owns the text now */
+          capture->text = NULL;
+        }
+      
+      g_ptr_array_unref (batch);
+    }
+  
+  scratchpad_pane_end_batch (pane);
+  
+  if (i == CAPTURE_BATCH)
+    return TRUE;
+  
+  g_atomic_int_set (&priv->scheduled, 0);
+
+  /* a batch can be queued after the last pop but before the reset */
+  if (g_async_queue_length (priv->captures) > 0 && 
+      g_atomic_int_compare_and_exchange (&priv->scheduled, 0, 1))
+    return TRUE;
+
+  return FALSE;
+}
+
+/*
+ * Text copied out of files with dos line endings would otherwise show 
+ * up with stray carriage returns. This only ever shrinks the text so it
+ * is done in place.
+ */
+static void
+normalize_text (gchar *text)
+{
+  gchar *read;
+  gchar *write;
+  
+  read = write = strchr (text, '\r');
+  if (read == NULL)
+    return;
+
+  while (*read != '\0')
+    {
+      if (read[0] == '\r' && read[1] == '\n')
+        read++;
+      *write++ = *read++;
+    }
+
+  *write = '\0';
+}
+
+static void
+capture_free (Capture *capture)
+{
+  if (capture->journal != NULL)
+    g_object_unref (capture->journal);
+  g_free (capture->text);
+  g_slice_free (Capture, capture);
+}
+
+static ScratchpadJournal*
+get_journal (ScratchpadEngine *engine)
+{
+  ScratchpadEnginePrivate *priv;
+  ScratchpadPane *pane;
+  priv = SCRATCHPAD_ENGINE_GET_PRIVATE (engine);
+  pane = scratchpad_pads_get_pane (SCRATCHPAD_PADS (priv->pads));
+  return scratchpad_store_get_journal (scratchpad_pane_get_store (pane));
 }
@@ -21,9 +21,12 @@
 
 #include <gtk/gtk.h>
 #include <codeslayer/codeslayer.h>
+#include "scratchpad-share.h"
 
 G_BEGIN_DECLS
 
+#define SCRATCHPAD_AUTO_CAPTURE "scratchpad_auto_capture"
+
 #define SCRATCHPAD_ENGINE_TYPE            (scratchpad_engine_get_type ())
 #define SCRATCHPAD_ENGINE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_ENGINE_TYPE, ScratchpadEngine))
 #define SCRATCHPAD_ENGINE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_ENGINE_TYPE, ScratchpadEngineClass))
@@ -32,6 +35,7 @@ G_BEGIN_DECLS
 
 typedef struct _ScratchpadEngine ScratchpadEngine;
 typedef struct _ScratchpadEngineClass ScratchpadEngineClass;
+typedef struct _ScratchpadRange ScratchpadRange;
 
 struct _ScratchpadEngine
 {
@@ -43,11 +47,30 @@ struct _ScratchpadEngineClass
   GObjectClass parent_class;
 };
 
+struct _ScratchpadRange
+{
+  CodeSlayerDocument *document;
+  GtkTextIter         start;
+  GtkTextIter         end;
+};
+
 GType scratchpad_engine_get_type (void) G_GNUC_CONST;
 
-ScratchpadEngine*  scratchpad_engine_new  (CodeSlayer *codeslayer,
-                                           GtkWidget  *menu, 
-                                           GtkWidget  *pane);
+ScratchpadEngine*  scratchpad_engine_new               (CodeSlayer       *codeslayer,
+                                                        GtkWidget        *menu, 
+                                                        GtkWidget        *pads);
+
+void               scratchpad_engine_capture_ranges    (ScratchpadEngine *engine,
+                                                        GList            *ranges);
+
+void               scratchpad_engine_set_share         (ScratchpadEngine *engine,
+                                                        ScratchpadShare  *share);
+
+void               scratchpad_engine_set_auto_capture  (ScratchpadEngine *engine,
+                                                        gboolean          auto_capture);
+
+void               scratchpad_engine_import            (ScratchpadEngine *engine,
+                                                        const gchar      *file_name);
 
 G_END_DECLS
 
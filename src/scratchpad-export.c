@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include "scratchpad-export.h"
+#include "scratchpad-stats.h"
+
+/*
+ * The snippets are written straight from the store one at a time, so 
+ * exporting never holds more than one snippet and the stdio buffer no 
+ * matter how big the pad is. The file is written next to the target and
+ * renamed over it at the end so a failed export does not leave half of 
+ * one behind.
+ */
+
+#define WRITE_BUFFER_SIZE 65536
+
+
+static void write_markdown     (FILE              *file,
+                                ScratchpadSnippet *snippet);
+static void write_json_line    (FILE              *file,
+                                ScratchpadSnippet *snippet);
+static void write_json_string  (FILE              *file,
+                                const gchar       *text);
+static void write_patch        (FILE              *file,
+                                ScratchpadSnippet *snippet);
+static void set_error          (GError           **error,
+                                const gchar       *file_name);
+
+/*
+ * The format that goes with the extension of the file, markdown when 
+ * there is nothing else to go by.
+ */
+ScratchpadExportFormat
+scratchpad_export_get_format (const gchar *file_name)
+{
+  if (g_str_has_suffix (file_name, ".jsonl") || g_str_has_suffix (file_name, ".json"))
+    return SCRATCHPAD_EXPORT_JSON_LINES;
+  if (g_str_has_suffix (file_name, ".patch") || g_str_has_suffix (file_name, ".diff"))
+    return SCRATCHPAD_EXPORT_PATCH;
+  return SCRATCHPAD_EXPORT_MARKDOWN;
+}
+
+gboolean
+scratchpad_export (ScratchpadStore        *store,
+                   const gchar            *file_name,
+                   ScratchpadExportFormat  format,
+                   GError                **error)
+{
+  FILE *file;
+  gchar *temp_name;
+  guint length;
+  guint i;
+  gboolean failed;
+  gint64 start_time;
+  
+  start_time = SCRATCHPAD_STATS_START ();
+  
+  temp_name = g_strconcat (file_name, ".tmp", NULL);
+
+  file = g_fopen (temp_name, "wb");
+  if (file == NULL)
+    {
+      set_error (error, temp_name);
+      g_free (temp_name);
+      return FALSE;
+    }
+  
+  setvbuf (file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+  
+  length = scratchpad_store_get_length (store);
+
+  for (i = 0; i < length; i++)
+    {
+      ScratchpadSnippet *snippet = scratchpad_store_get (store, i);
+
+      switch (format)
+        {
+        case SCRATCHPAD_EXPORT_MARKDOWN:
+          write_markdown (file, snippet);
+          break;
+        case SCRATCHPAD_EXPORT_JSON_LINES:
+          write_json_line (file, snippet);
+          break;
+        case SCRATCHPAD_EXPORT_PATCH:
+          write_patch (file, snippet);
+          break;
+        }
+      
+      if (i % SCRATCHPAD_STORE_TRIM_INTERVAL == SCRATCHPAD_STORE_TRIM_INTERVAL - 1)
+        scratchpad_store_trim (store);
+    }
+  
+  scratchpad_store_trim (store);
+  
+  failed = ferror (file) != 0;
+  failed |= fclose (file) != 0;
+  
+  if (failed || g_rename (temp_name, file_name) != 0)
+    {
+      set_error (error, file_name);
+      g_unlink (temp_name);
+      g_free (temp_name);
+      return FALSE;
+    }
+  
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_EXPORT, start_time);
+
+  g_free (temp_name);
+  return TRUE;
+}
+
+/*
+ * The fence is made longer than any run of backticks in the text so that 
+ * code which has fences of its own comes through whole.
+ */
+static void
+write_markdown (FILE              *file,
+                ScratchpadSnippet *snippet)
+{
+  const gchar *text;
+  gint longest = 0;
+  gint run = 0;
+  gint i;
+  
+  for (text = snippet->text; *text != '\0'; text++)
+    {
+      run = *text == '`' ? run + 1 : 0;
+      longest = MAX (longest, run);
+    }
+  
+  fprintf (file, "## %s:%d\n\n", snippet->file_path, snippet->line_number);
+  
+  for (i = 0; i < MAX (3, longest + 1); i++)
+    fputc ('`', file);
+  fputc ('\n', file);
+
+  fputs (snippet->text, file);
+  if (text != snippet->text && text[-1] != '\n')
+    fputc ('\n', file);
+
+  for (i = 0; i < MAX (3, longest + 1); i++)
+    fputc ('`', file);
+  fputs ("\n\n", file);
+}
+
+static void
+write_json_line (FILE              *file,
+                 ScratchpadSnippet *snippet)
+{
+  fputs ("{\"file\": ", file);
+  write_json_string (file, snippet->file_path);
+  fprintf (file, ", \"line\": %d, \"timestamp\": %" G_GINT64_FORMAT ", \"count\": %u, \"text\": ", 
+           snippet->line_number, snippet->timestamp, MAX (snippet->count, 1));
+  write_json_string (file, snippet->text);
+  fputs ("}\n", file);
+}
+
+/*
+ * Plain runs of the text are written as they are and only the characters
+ * that json needs escaped are written one at a time.
+ */
+static void
+write_json_string (FILE        *file,
+                   const gchar *text)
+{
+  const gchar *run;
+
+  fputc ('"', file);
+
+  for (run = text; *text != '\0'; text++)
+    {
+      guchar c = *text;
+      
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      fwrite (run, 1, text - run, file);
+      run = text + 1;
+      
+      switch (c)
+        {
+        case '"':
+          fputs ("\\\"", file);
+          break;
+        case '\\':
+          fputs ("\\\\", file);
+          break;
+        case '\n':
+          fputs ("\\n", file);
+          break;
+        case '\t':
+          fputs ("\\t", file);
+          break;
+        default:
+          fprintf (file, "\\u%04x", c);
+          break;
+        }
+    }
+  
+  fwrite (run, 1, text - run, file);
+  fputc ('"', file);
+}
+
+/*
+ * Every line of the snippet goes in as context, which is enough for diff 
+ * tools and editors to show it at its place in the file.
+ */
+static void
+write_patch (FILE              *file,
+             ScratchpadSnippet *snippet)
+{
+  const gchar *line;
+  const gchar *line_end;
+  gint count = 0;
+  
+  for (line = snippet->text; *line != '\0'; line = line_end + 1)
+    {
+      count++;
+      line_end = strchr (line, '\n');
+      if (line_end == NULL)
+        break;
+    }
+  
+  fprintf (file, "--- %s\n+++ %s\n@@ -%d,%d +%d,%d @@\n", 
+           snippet->file_path, snippet->file_path, 
+           MAX (snippet->line_number, 1), count, MAX (snippet->line_number, 1), count);
+
+  for (line = snippet->text; *line != '\0'; line = line_end + 1)
+    {
+      line_end = strchr (line, '\n');
+      fputc (' ', file);
+      if (line_end == NULL)
+        {
+          fputs (line, file);
+          fputc ('\n', file);
+          break;
+        }
+      fwrite (line, 1, line_end - line + 1, file);
+    }
+}
+
+static void
+set_error (GError      **error,
+           const gchar  *file_name)
+{
+  gint saved_errno = errno;
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+               "Can not write %s: %s", file_name, g_strerror (saved_errno));
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_EXPORT_H__
+#define	__SCRATCHPAD_EXPORT_H__
+
+#include <gtk/gtk.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  SCRATCHPAD_EXPORT_MARKDOWN,
+  SCRATCHPAD_EXPORT_JSON_LINES,
+  SCRATCHPAD_EXPORT_PATCH
+} ScratchpadExportFormat;
+
+ScratchpadExportFormat  scratchpad_export_get_format  (const gchar            *file_name);
+
+gboolean                scratchpad_export             (ScratchpadStore        *store,
+                                                       const gchar            *file_name,
+                                                       ScratchpadExportFormat  format,
+                                                       GError                **error);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_EXPORT_H__ */
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <gtksourceview/gtksourcelanguagemanager.h>
+#include "scratchpad-highlighter.h"
+
+/*
+ * Snippets come from all kinds of files, so the pad buffer can not be 
+ * given a language of its own. Each snippet is instead run through a 
+ * scratch buffer that has the language of its file, and the spans of the
+ * tags the syntax engine put on it are kept with the snippet. Painting a
+ * snippet that has been highlighted before is only applying those spans
+ * to the pad buffer again, with tags that look the same as the ones in 
+ * the scratch buffer.
+ */
+
+typedef struct
+{
+  gint        start;
+  gint        length;
+  GtkTextTag *tag;
+} Span;
+
+static void scratchpad_highlighter_class_init  (ScratchpadHighlighterClass *klass);
+static void scratchpad_highlighter_init        (ScratchpadHighlighter      *highlighter);
+static void scratchpad_highlighter_finalize    (ScratchpadHighlighter      *highlighter);
+
+static GArray* compute_highlights              (ScratchpadHighlighter      *highlighter,
+                                                ScratchpadSnippet          *snippet);
+static GtkSourceLanguage* get_language         (ScratchpadHighlighter      *highlighter,
+                                                const gchar                *file_path);
+static GtkSourceBuffer* get_scratch_buffer     (ScratchpadHighlighter      *highlighter,
+                                                GtkSourceLanguage          *language);
+static GtkTextTag* get_tag                     (ScratchpadHighlighter      *highlighter,
+                                                GtkTextTag                 *source);
+
+#define SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_HIGHLIGHTER_TYPE, ScratchpadHighlighterPrivate))
+
+typedef struct _ScratchpadHighlighterPrivate ScratchpadHighlighterPrivate;
+
+struct _ScratchpadHighlighterPrivate
+{
+  GtkTextBuffer *buffer;
+  GHashTable    *languages;
+  GHashTable    *scratch_buffers;
+  GHashTable    *tags;
+};
+
+G_DEFINE_TYPE (ScratchpadHighlighter, scratchpad_highlighter, G_TYPE_OBJECT)
+
+static void
+scratchpad_highlighter_class_init (ScratchpadHighlighterClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_highlighter_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadHighlighterPrivate));
+}
+
+static void
+scratchpad_highlighter_init (ScratchpadHighlighter *highlighter) 
+{
+  ScratchpadHighlighterPrivate *priv;
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  
+  /* file paths are interned, a path without a language maps to NULL */
+  priv->languages = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->scratch_buffers = g_hash_table_new_full (g_direct_hash, g_direct_equal, 
+                                                 NULL, g_object_unref);
+  priv->tags = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static void
+scratchpad_highlighter_finalize (ScratchpadHighlighter *highlighter)
+{
+  ScratchpadHighlighterPrivate *priv;
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  
+  g_hash_table_destroy (priv->languages);
+  g_hash_table_destroy (priv->scratch_buffers);
+  g_hash_table_destroy (priv->tags);
+
+  G_OBJECT_CLASS (scratchpad_highlighter_parent_class)->finalize (G_OBJECT (highlighter));
+}
+
+ScratchpadHighlighter*
+scratchpad_highlighter_new (GtkTextBuffer *buffer)
+{
+  ScratchpadHighlighterPrivate *priv;
+  ScratchpadHighlighter *highlighter;
+
+  highlighter = SCRATCHPAD_HIGHLIGHTER (g_object_new (scratchpad_highlighter_get_type (), NULL));
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  priv->buffer = buffer;
+
+  return highlighter;
+}
+
+/*
+ * Color the snippet whose body starts at the iter. The highlighting is 
+ * worked out the first time and kept with the snippet after that.
+ */
+void
+scratchpad_highlighter_paint (ScratchpadHighlighter *highlighter,
+                              ScratchpadSnippet     *snippet,
+                              GtkTextIter           *start)
+{
+  ScratchpadHighlighterPrivate *priv;
+  gint offset;
+  guint i;
+
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  
+  if (snippet->highlights == NULL)
+    snippet->highlights = compute_highlights (highlighter, snippet);
+
+  offset = gtk_text_iter_get_offset (start);
+
+  for (i = 0; i < snippet->highlights->len; i++)
+    {
+      Span *span = &g_array_index (snippet->highlights, Span, i);
+      GtkTextIter span_start, span_end;
+      
+      gtk_text_buffer_get_iter_at_offset (priv->buffer, &span_start, offset + span->start);
+      gtk_text_buffer_get_iter_at_offset (priv->buffer, &span_end, offset + span->start + span->length);
+      gtk_text_buffer_apply_tag (priv->buffer, span->tag, &span_start, &span_end);
+    }
+  
+  snippet->painted = TRUE;
+}
+
+static GArray*
+compute_highlights (ScratchpadHighlighter *highlighter,
+                    ScratchpadSnippet     *snippet)
+{
+  GtkSourceLanguage *language;
+  GtkSourceBuffer *scratch_buffer;
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end, iter;
+  GArray *spans;
+
+  spans = g_array_new (FALSE, FALSE, sizeof (Span));
+  
+  language = get_language (highlighter, snippet->file_path);
+  if (language == NULL)
+    return spans;
+  
+  scratch_buffer = get_scratch_buffer (highlighter, language);
+  buffer = GTK_TEXT_BUFFER (scratch_buffer);
+  
+  gtk_text_buffer_set_text (buffer, snippet->text, -1);
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  gtk_source_buffer_ensure_highlight (scratch_buffer, &start, &end);
+  
+  iter = start;
+
+  do
+    {
+      GSList *tags;
+      GSList *list;
+      
+      tags = gtk_text_iter_get_toggled_tags (&iter, TRUE);
+
+      for (list = tags; list != NULL; list = g_slist_next (list))
+        {
+          GtkTextTag *tag = list->data;
+          GtkTextIter tag_end = iter;
+          Span span;
+          
+          gtk_text_iter_forward_to_tag_toggle (&tag_end, tag);
+          
+          span.start = gtk_text_iter_get_offset (&iter);
+          span.length = gtk_text_iter_get_offset (&tag_end) - span.start;
+          span.tag = get_tag (highlighter, tag);
+          
+          if (span.tag != NULL && span.length > 0)
+            g_array_append_val (spans, span);
+        }
+      
+      g_slist_free (tags);
+    }
+  while (gtk_text_iter_forward_to_tag_toggle (&iter, NULL));
+  
+  gtk_text_buffer_set_text (buffer, "", 0);
+  
+  return spans;
+}
+
+static GtkSourceLanguage*
+get_language (ScratchpadHighlighter *highlighter,
+              const gchar           *file_path)
+{
+  ScratchpadHighlighterPrivate *priv;
+  GtkSourceLanguage *language;
+  gpointer value;
+  
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  
+  if (g_hash_table_lookup_extended (priv->languages, file_path, NULL, &value))
+    return value;
+  
+  language = gtk_source_language_manager_guess_language (gtk_source_language_manager_get_default (), 
+                                                         file_path, NULL);
+  g_hash_table_insert (priv->languages, (gpointer) file_path, language);
+  
+  return language;
+}
+
+/*
+ * One scratch buffer per language, so the tags that come out of each stay
+ * the same from one snippet to the next.
+ */
+static GtkSourceBuffer*
+get_scratch_buffer (ScratchpadHighlighter *highlighter,
+                    GtkSourceLanguage     *language)
+{
+  ScratchpadHighlighterPrivate *priv;
+  GtkSourceBuffer *scratch_buffer;
+  
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  
+  scratch_buffer = g_hash_table_lookup (priv->scratch_buffers, language);
+  if (scratch_buffer != NULL)
+    return scratch_buffer;
+  
+  scratch_buffer = gtk_source_buffer_new_with_language (language);
+  gtk_source_buffer_set_highlight_syntax (scratch_buffer, TRUE);
+  gtk_source_buffer_set_style_scheme (scratch_buffer, 
+                                      gtk_source_buffer_get_style_scheme (GTK_SOURCE_BUFFER (priv->buffer)));
+  
+  g_hash_table_insert (priv->scratch_buffers, language, scratch_buffer);
+  
+  return scratch_buffer;
+}
+
+/*
+ * A tag in the pad buffer that looks like one the syntax engine made. It
+ * is the lowest priority tag so the header and search tags still show.
+ */
+static GtkTextTag*
+get_tag (ScratchpadHighlighter *highlighter,
+         GtkTextTag            *source)
+{
+  ScratchpadHighlighterPrivate *priv;
+  GtkTextTag *tag;
+  GdkRGBA *foreground;
+  GdkRGBA *background;
+  gboolean foreground_set, background_set;
+  gboolean weight_set, style_set, underline_set, strikethrough_set;
+  gint weight;
+  PangoStyle style;
+  PangoUnderline underline;
+  gboolean strikethrough;
+  
+  priv = SCRATCHPAD_HIGHLIGHTER_GET_PRIVATE (highlighter);
+  
+  tag = g_hash_table_lookup (priv->tags, source);
+  if (tag != NULL)
+    return tag;
+  
+  g_object_get (source, 
+                "foreground-rgba", &foreground, "foreground-set", &foreground_set,
+                "background-rgba", &background, "background-set", &background_set,
+                "weight", &weight, "weight-set", &weight_set,
+                "style", &style, "style-set", &style_set,
+                "underline", &underline, "underline-set", &underline_set,
+                "strikethrough", &strikethrough, "strikethrough-set", &strikethrough_set,
+                NULL);
+
+  tag = gtk_text_buffer_create_tag (priv->buffer, NULL, NULL);
+  
+  if (foreground_set)
+    g_object_set (tag, "foreground-rgba", foreground, NULL);
+  if (background_set)
+    g_object_set (tag, "background-rgba", background, NULL);
+  if (weight_set)
+    g_object_set (tag, "weight", weight, NULL);
+  if (style_set)
+    g_object_set (tag, "style", style, NULL);
+  if (underline_set)
+    g_object_set (tag, "underline", underline, NULL);
+  if (strikethrough_set)
+    g_object_set (tag, "strikethrough", strikethrough, NULL);
+  
+  gtk_text_tag_set_priority (tag, 0);
+  
+  if (foreground != NULL)
+    gdk_rgba_free (foreground);
+  if (background != NULL)
+    gdk_rgba_free (background);
+  
+  g_hash_table_insert (priv->tags, source, tag);
+  
+  return tag;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_HIGHLIGHTER_H__
+#define	__SCRATCHPAD_HIGHLIGHTER_H__
+
+#include <gtk/gtk.h>
+#include <gtksourceview/gtksourceview.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_HIGHLIGHTER_TYPE            (scratchpad_highlighter_get_type ())
+#define SCRATCHPAD_HIGHLIGHTER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_HIGHLIGHTER_TYPE, ScratchpadHighlighter))
+#define SCRATCHPAD_HIGHLIGHTER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_HIGHLIGHTER_TYPE, ScratchpadHighlighterClass))
+#define IS_SCRATCHPAD_HIGHLIGHTER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_HIGHLIGHTER_TYPE))
+#define IS_SCRATCHPAD_HIGHLIGHTER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_HIGHLIGHTER_TYPE))
+
+typedef struct _ScratchpadHighlighter ScratchpadHighlighter;
+typedef struct _ScratchpadHighlighterClass ScratchpadHighlighterClass;
+
+struct _ScratchpadHighlighter
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadHighlighterClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_highlighter_get_type (void) G_GNUC_CONST;
+
+ScratchpadHighlighter*  scratchpad_highlighter_new    (GtkTextBuffer         *buffer);
+
+void                    scratchpad_highlighter_paint  (ScratchpadHighlighter *highlighter,
+                                                       ScratchpadSnippet     *snippet,
+                                                       GtkTextIter           *start);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_HIGHLIGHTER_H__ */
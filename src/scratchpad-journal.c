@@ -0,0 +1,717 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <glib/gstdio.h>
+#include "scratchpad-journal.h"
+
+/*
+ * The journal is a magic string followed by length prefixed records, all 
+ * numbers little endian:
+ *
+ *   guint32 length    size of the rest of the record
+ *   gint64  timestamp
+ *   gint32  line_number
+ *   guint32 path_size size of the file path including its nul
+ *   gchar   file_path[path_size]
+ *   gchar   text[]    the rest of the record including its nul
+ *
+ * Keeping the nul bytes on disk lets the text be used straight out of the
+ * mapping. Next to it the index file is an array of guint64 record offsets, 
+ * with a zero offset for a removed snippet. Records are written to the 
+ * journal before the index, so the index is never ahead of the journal.
+ *
+ * Records are appended from the capture worker while the main loop reads 
+ * and removes them, so everything past loading is done under the lock.
+ * Removed records stay in the journal until it is opened with enough of
+ * them to be worth writing it out again without them.
+ *
+ * The journal is read through mappings that each cover the records that
+ * were written since the one before, and they all live as long as the 
+ * journal does, since the text of a snippet points straight into them.
+ * Reading a record written since the last mapping maps just the new part.
+ */
+
+#define JOURNAL_MAGIC "SPJRNL01"
+#define JOURNAL_MAGIC_SIZE 8
+#define RECORD_HEADER_SIZE (4 + 8 + 4 + 4)
+
+/* compact once at least this many records, and half of them all, are removed */
+#define COMPACT_MIN_REMOVED 256
+
+typedef struct
+{
+  guint64  start;
+  guint64  end;
+  guint64  base;
+  gchar   *data;
+} Chunk;
+
+static void scratchpad_journal_class_init  (ScratchpadJournalClass *klass);
+static void scratchpad_journal_init        (ScratchpadJournal      *journal);
+static void scratchpad_journal_finalize    (ScratchpadJournal      *journal);
+
+static void load_index                     (ScratchpadJournal      *journal);
+static void recover_index                  (ScratchpadJournal      *journal,
+                                            const gchar            *contents,
+                                            gsize                   length);
+static void compact                        (ScratchpadJournal      *journal,
+                                            const gchar            *contents);
+static gboolean write_compacted            (ScratchpadJournal      *journal,
+                                            const gchar            *contents,
+                                            GArray                 *offsets,
+                                            guint64                *size);
+static void finish_compaction              (ScratchpadJournal      *journal);
+static const gchar* find_record            (ScratchpadJournal      *journal,
+                                            guint64                 offset,
+                                            guint32                *length);
+static gboolean map_chunk                  (ScratchpadJournal      *journal);
+static guint32 read_guint32                (const gchar            *data);
+
+#define SCRATCHPAD_JOURNAL_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_JOURNAL_TYPE, ScratchpadJournalPrivate))
+
+typedef struct _ScratchpadJournalPrivate ScratchpadJournalPrivate;
+
+struct _ScratchpadJournalPrivate
+{
+  gchar       *file_path;
+  gchar       *index_path;
+  gchar       *temp_path;
+  gchar       *temp_index_path;
+  gchar       *marker_path;
+  GArray      *chunks;
+  GArray      *offsets;
+  FILE        *journal_file;
+  FILE        *index_file;
+  guint64      journal_size;
+  GMutex       lock;
+};
+
+G_DEFINE_TYPE (ScratchpadJournal, scratchpad_journal, G_TYPE_OBJECT)
+
+static void
+scratchpad_journal_class_init (ScratchpadJournalClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_journal_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadJournalPrivate));
+}
+
+static void
+scratchpad_journal_init (ScratchpadJournal *journal) 
+{
+  ScratchpadJournalPrivate *priv;
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  priv->offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  priv->chunks = g_array_new (FALSE, FALSE, sizeof (Chunk));
+  priv->journal_file = NULL;
+  priv->index_file = NULL;
+  priv->journal_size = 0;
+  g_mutex_init (&priv->lock);
+}
+
+static void
+scratchpad_journal_finalize (ScratchpadJournal *journal)
+{
+  ScratchpadJournalPrivate *priv;
+  guint i;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  if (priv->journal_file != NULL)
+    fclose (priv->journal_file);
+  if (priv->index_file != NULL)
+    fclose (priv->index_file);
+  
+  for (i = 0; i < priv->chunks->len; i++)
+    {
+      Chunk *chunk = &g_array_index (priv->chunks, Chunk, i);
+      munmap (chunk->data, chunk->end - chunk->base);
+    }
+  g_array_free (priv->chunks, TRUE);
+
+  g_array_free (priv->offsets, TRUE);
+  g_free (priv->file_path);
+  g_free (priv->index_path);
+  g_free (priv->temp_path);
+  g_free (priv->temp_index_path);
+  g_free (priv->marker_path);
+  g_mutex_clear (&priv->lock);
+
+  G_OBJECT_CLASS (scratchpad_journal_parent_class)->finalize (G_OBJECT (journal));
+}
+
+ScratchpadJournal*
+scratchpad_journal_new (const gchar *file_path)
+{
+  ScratchpadJournalPrivate *priv;
+  ScratchpadJournal *journal;
+  gchar *folder_path;
+
+  journal = SCRATCHPAD_JOURNAL (g_object_new (scratchpad_journal_get_type (), NULL));
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  priv->file_path = g_strdup (file_path);
+  priv->index_path = g_strconcat (file_path, ".index", NULL);
+  priv->temp_path = g_strconcat (priv->file_path, ".compact", NULL);
+  priv->temp_index_path = g_strconcat (priv->index_path, ".compact", NULL);
+  priv->marker_path = g_strconcat (priv->file_path, ".compacted", NULL);
+  
+  folder_path = g_path_get_dirname (file_path);
+  g_mkdir_with_parents (folder_path, 0700);
+  g_free (folder_path);
+  
+  load_index (journal);
+  
+  priv->journal_file = g_fopen (priv->file_path, "ab");
+  if (priv->journal_file != NULL && priv->journal_size == 0)
+    {
+      fwrite (JOURNAL_MAGIC, 1, JOURNAL_MAGIC_SIZE, priv->journal_file);
+      fflush (priv->journal_file);
+      priv->journal_size = JOURNAL_MAGIC_SIZE;
+    }
+
+  return journal;
+}
+
+/*
+ * Map the journal and pull in the index. Nothing in the records is looked 
+ * at here, that waits until a snippet is actually shown.
+ */
+static void
+load_index (ScratchpadJournal *journal)
+{
+  ScratchpadJournalPrivate *priv;
+  GMappedFile *mapped_file;
+  GMappedFile *index_file;
+  const gchar *contents;
+  gsize length;
+  guint count;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  finish_compaction (journal);
+
+  mapped_file = g_mapped_file_new (priv->file_path, FALSE, NULL);
+  if (mapped_file == NULL)
+    {
+      g_remove (priv->index_path);
+      priv->index_file = g_fopen (priv->index_path, "w+b");
+      return;
+    }
+
+  contents = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+  
+  if (length < JOURNAL_MAGIC_SIZE || memcmp (contents, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) != 0)
+    {
+      g_warning ("scratchpad journal %s is not valid, starting over", priv->file_path);
+      g_mapped_file_unref (mapped_file);
+      g_remove (priv->file_path);
+      g_remove (priv->index_path);
+      priv->index_file = g_fopen (priv->index_path, "w+b");
+      return;
+    }
+  
+  priv->journal_size = length;
+
+  index_file = g_mapped_file_new (priv->index_path, FALSE, NULL);
+  if (index_file != NULL)
+    {
+      count = g_mapped_file_get_length (index_file) / sizeof (guint64);
+      g_array_set_size (priv->offsets, count);
+      if (count > 0)
+        memcpy (priv->offsets->data, g_mapped_file_get_contents (index_file), 
+                count * sizeof (guint64));
+      g_mapped_file_unref (index_file);
+    }
+
+  recover_index (journal, contents, length);
+  compact (journal, contents);
+  
+  /* the records are mapped again as they are read */
+  g_mapped_file_unref (mapped_file);
+}
+
+/*
+ * Walk the records past the last one in the index. This is only more than
+ * a bounds check when the index was lost or we went down between writes.
+ * The index is never ahead of the journal, so the record in each slot is 
+ * the one at that position in the journal. A removed slot no longer has 
+ * its offset, so the walk starts from the last slot that does and hops 
+ * over the records of the removed slots after it, which are still in the
+ * journal and must not be indexed again.
+ */
+static void
+recover_index (ScratchpadJournal *journal,
+               const gchar       *contents,
+               gsize              length)
+{
+  ScratchpadJournalPrivate *priv;
+  guint64 offset = JOURNAL_MAGIC_SIZE;
+  guint skip;
+  guint start;
+  gint i;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+
+  for (i = priv->offsets->len - 1; i >= 0; i--)
+    if (g_array_index (priv->offsets, guint64, i) != 0)
+      break;
+  
+  skip = priv->offsets->len;
+  if (i >= 0)
+    {
+      offset = GUINT64_FROM_LE (g_array_index (priv->offsets, guint64, i));
+      skip = priv->offsets->len - i;
+    }
+  
+  for (; skip > 0 && offset + 4 <= length; skip--)
+    offset += 4 + read_guint32 (contents + offset);
+  
+  /* an index that does not fit the journal is built again from scratch */
+  if (skip > 0 || offset > length)
+    {
+      g_array_set_size (priv->offsets, 0);
+      offset = JOURNAL_MAGIC_SIZE;
+    }
+  
+  start = priv->offsets->len;
+
+  while (offset + RECORD_HEADER_SIZE <= length)
+    {
+      guint64 value = GUINT64_TO_LE (offset);
+      guint64 next = offset + 4 + read_guint32 (contents + offset);
+      if (next > length)
+        break;
+      g_array_append_val (priv->offsets, value);
+      offset = next;
+    }
+
+  /* drop a record that was cut off half way */
+  if (offset < length)
+    {
+      priv->journal_size = offset;
+      if (truncate (priv->file_path, offset) != 0)
+        g_warning ("could not truncate scratchpad journal %s", priv->file_path);
+    }
+  
+  priv->index_file = g_fopen (priv->index_path, priv->offsets->len > 0 ? "r+b" : "w+b");
+  if (priv->index_file == NULL)
+    priv->index_file = g_fopen (priv->index_path, "w+b");
+
+  if (priv->index_file != NULL && start < priv->offsets->len)
+    {
+      fseek (priv->index_file, start * sizeof (guint64), SEEK_SET);
+      fwrite (&g_array_index (priv->offsets, guint64, start), sizeof (guint64), 
+              priv->offsets->len - start, priv->index_file);
+      fflush (priv->index_file);
+    }
+}
+
+guint
+scratchpad_journal_get_length (ScratchpadJournal *journal)
+{
+  ScratchpadJournalPrivate *priv;
+  guint length;
+
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+
+  g_mutex_lock (&priv->lock);
+  length = priv->offsets->len;
+  g_mutex_unlock (&priv->lock);
+
+  return length;
+}
+
+gboolean
+scratchpad_journal_is_removed (ScratchpadJournal *journal,
+                               guint              record)
+{
+  ScratchpadJournalPrivate *priv;
+  gboolean removed;
+
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+
+  g_mutex_lock (&priv->lock);
+  removed = g_array_index (priv->offsets, guint64, record) == 0;
+  g_mutex_unlock (&priv->lock);
+
+  return removed;
+}
+
+guint
+scratchpad_journal_append (ScratchpadJournal *journal,
+                           ScratchpadSnippet *snippet)
+{
+  ScratchpadJournalPrivate *priv;
+  guint32 path_size, text_size;
+  guint32 length, line_number, size;
+  gint64 timestamp;
+  guint64 offset;
+  guint record;
+
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  if (priv->journal_file == NULL || priv->index_file == NULL)
+    return G_MAXUINT;
+
+  path_size = strlen (snippet->file_path) + 1;
+  text_size = strlen (snippet->text) + 1;
+  length = RECORD_HEADER_SIZE - 4 + path_size + text_size;
+  
+  size = GUINT32_TO_LE (length);
+  timestamp = GINT64_TO_LE (snippet->timestamp);
+  line_number = GUINT32_TO_LE ((guint32) snippet->line_number);
+  path_size = GUINT32_TO_LE (path_size);
+  
+  g_mutex_lock (&priv->lock);
+
+  fwrite (&size, 4, 1, priv->journal_file);
+  fwrite (&timestamp, 8, 1, priv->journal_file);
+  fwrite (&line_number, 4, 1, priv->journal_file);
+  fwrite (&path_size, 4, 1, priv->journal_file);
+  fwrite (snippet->file_path, 1, GUINT32_FROM_LE (path_size), priv->journal_file);
+  fwrite (snippet->text, 1, text_size, priv->journal_file);
+  fflush (priv->journal_file);
+
+  offset = GUINT64_TO_LE (priv->journal_size);
+  priv->journal_size += 4 + length;
+  g_array_append_val (priv->offsets, offset);
+
+  fseek (priv->index_file, 0, SEEK_END);
+  fwrite (&offset, sizeof (guint64), 1, priv->index_file);
+  fflush (priv->index_file);
+  
+  record = priv->offsets->len - 1;
+
+  g_mutex_unlock (&priv->lock);
+
+  return record;
+}
+
+void
+scratchpad_journal_remove (ScratchpadJournal *journal,
+                           guint              record)
+{
+  ScratchpadJournalPrivate *priv;
+  guint64 offset = 0;
+
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  g_mutex_lock (&priv->lock);
+  
+  if (record < priv->offsets->len && priv->index_file != NULL)
+    {
+      g_array_index (priv->offsets, guint64, record) = 0;
+      fseek (priv->index_file, record * sizeof (guint64), SEEK_SET);
+      fwrite (&offset, sizeof (guint64), 1, priv->index_file);
+      fflush (priv->index_file);
+    }
+
+  g_mutex_unlock (&priv->lock);
+}
+
+/*
+ * Fill in a snippet from its record. The text is not copied, it points 
+ * into the mapping which lives as long as the journal does. A record that
+ * does not fit in its mapping or whose strings are not terminated inside 
+ * it is not read.
+ */
+gboolean
+scratchpad_journal_read (ScratchpadJournal *journal,
+                         ScratchpadSnippet *snippet)
+{
+  ScratchpadJournalPrivate *priv;
+  const gchar *record = NULL;
+  guint64 offset = 0;
+  guint32 length = 0;
+  guint32 path_size;
+  gint64 timestamp;
+
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  g_mutex_lock (&priv->lock);
+  
+  if (snippet->record < priv->offsets->len)
+    offset = GUINT64_FROM_LE (g_array_index (priv->offsets, guint64, snippet->record));
+  
+  if (offset != 0)
+    record = find_record (journal, offset, &length);
+  
+  g_mutex_unlock (&priv->lock);
+
+  if (record == NULL || length < RECORD_HEADER_SIZE - 4 + 2)
+    return FALSE;
+  
+  memcpy (&timestamp, record + 4, 8);
+  path_size = read_guint32 (record + 16);
+  
+  /* both strings have to end inside the record, the text last of all */
+  if (path_size == 0 || (guint64) path_size + RECORD_HEADER_SIZE - 4 >= length ||
+      record[RECORD_HEADER_SIZE + path_size - 1] != '\0' || 
+      record[4 + length - 1] != '\0')
+    return FALSE;
+  
+  snippet->timestamp = GINT64_FROM_LE (timestamp);
+  snippet->line_number = (gint) read_guint32 (record + 12);
+  snippet->file_path = g_intern_string (record + RECORD_HEADER_SIZE);
+  snippet->text = (gchar*) record + RECORD_HEADER_SIZE + path_size;
+  
+  return TRUE;
+}
+
+/*
+ * Write the records that are left to a new journal and index, then move 
+ * them over the old ones. The marker file is what commits the swap: once 
+ * it is there the new pair is moved into place even if we go down part 
+ * way, and before it is there the old pair is left as it was. The old 
+ * journal is never seen without its own index, which would bring back 
+ * every record removed from it. The records are numbered again, which is
+ * fine as nothing has read them yet.
+ */
+static void
+compact (ScratchpadJournal *journal,
+         const gchar       *contents)
+{
+  ScratchpadJournalPrivate *priv;
+  GArray *offsets;
+  guint64 size;
+  guint removed = 0;
+  guint i;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  if (priv->index_file == NULL)
+    return;
+
+  for (i = 0; i < priv->offsets->len; i++)
+    if (g_array_index (priv->offsets, guint64, i) == 0)
+      removed++;
+  
+  if (removed < COMPACT_MIN_REMOVED || removed * 2 < priv->offsets->len)
+    return;
+  
+  offsets = g_array_sized_new (FALSE, FALSE, sizeof (guint64), priv->offsets->len - removed);
+  
+  if (!write_compacted (journal, contents, offsets, &size) ||
+      !g_file_set_contents (priv->marker_path, "", 0, NULL))
+    {
+      g_warning ("could not compact scratchpad journal %s", priv->file_path);
+      g_remove (priv->temp_path);
+      g_remove (priv->temp_index_path);
+      g_array_free (offsets, TRUE);
+      return;
+    }
+  
+  fclose (priv->index_file);
+  finish_compaction (journal);
+  
+  priv->journal_size = size;
+  
+  g_array_free (priv->offsets, TRUE);
+  priv->offsets = offsets;
+  
+  priv->index_file = g_fopen (priv->index_path, "r+b");
+}
+
+static gboolean
+write_compacted (ScratchpadJournal *journal,
+                 const gchar       *contents,
+                 GArray            *offsets,
+                 guint64           *size)
+{
+  ScratchpadJournalPrivate *priv;
+  FILE *file;
+  FILE *index_file;
+  gboolean failed;
+  guint i;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+
+  file = g_fopen (priv->temp_path, "wb");
+  if (file == NULL)
+    return FALSE;
+
+  index_file = g_fopen (priv->temp_index_path, "wb");
+  if (index_file == NULL)
+    {
+      fclose (file);
+      return FALSE;
+    }
+  
+  fwrite (JOURNAL_MAGIC, 1, JOURNAL_MAGIC_SIZE, file);
+  *size = JOURNAL_MAGIC_SIZE;
+  
+  for (i = 0; i < priv->offsets->len; i++)
+    {
+      guint64 offset = GUINT64_FROM_LE (g_array_index (priv->offsets, guint64, i));
+      guint64 value;
+      guint32 length;
+      
+      if (offset == 0 || offset + 4 > priv->journal_size)
+        continue;
+      
+      length = read_guint32 (contents + offset);
+      if (offset + 4 + length > priv->journal_size)
+        continue;
+      
+      fwrite (contents + offset, 1, 4 + length, file);
+      
+      value = GUINT64_TO_LE (*size);
+      g_array_append_val (offsets, value);
+      *size += 4 + length;
+    }
+  
+  fwrite (offsets->data, sizeof (guint64), offsets->len, index_file);
+  
+  /* both have to be on disk before the marker says to use them */
+  failed = fflush (file) != 0 || fflush (index_file) != 0;
+  failed |= fsync (fileno (file)) != 0 || fsync (fileno (index_file)) != 0;
+  failed |= ferror (file) != 0 || ferror (index_file) != 0;
+  failed |= fclose (file) != 0;
+  failed |= fclose (index_file) != 0;
+  
+  return !failed;
+}
+
+/*
+ * Move a compacted journal and index into place if the marker says they 
+ * are complete, otherwise throw away whatever was left of them.
+ */
+static void
+finish_compaction (ScratchpadJournal *journal)
+{
+  ScratchpadJournalPrivate *priv;
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+
+  if (g_file_test (priv->marker_path, G_FILE_TEST_EXISTS))
+    {
+      if (g_file_test (priv->temp_path, G_FILE_TEST_EXISTS))
+        g_rename (priv->temp_path, priv->file_path);
+      if (g_file_test (priv->temp_index_path, G_FILE_TEST_EXISTS))
+        g_rename (priv->temp_index_path, priv->index_path);
+      g_remove (priv->marker_path);
+      return;
+    }
+  
+  g_remove (priv->temp_path);
+  g_remove (priv->temp_index_path);
+}
+
+/*
+ * The record at the offset and its length, or NULL. Records past the last
+ * mapping were written since it was made and are mapped first. Called 
+ * with the lock held.
+ */
+static const gchar*
+find_record (ScratchpadJournal *journal,
+             guint64            offset,
+             guint32           *length)
+{
+  ScratchpadJournalPrivate *priv;
+  Chunk *chunk;
+  guint low, high;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  if (priv->chunks->len == 0 || 
+      offset >= g_array_index (priv->chunks, Chunk, priv->chunks->len - 1).end)
+    map_chunk (journal);
+  
+  /* the chunks are in order and run on from one another */
+  low = 0;
+  high = priv->chunks->len;
+  while (low < high)
+    {
+      guint middle = (low + high) / 2;
+      if (g_array_index (priv->chunks, Chunk, middle).end <= offset)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+  
+  if (low == priv->chunks->len)
+    return NULL;
+  
+  chunk = &g_array_index (priv->chunks, Chunk, low);
+  if (offset < chunk->start || offset + 4 > chunk->end)
+    return NULL;
+  
+  *length = read_guint32 (chunk->data + (offset - chunk->base));
+  if (offset + 4 + *length > chunk->end)
+    return NULL;
+  
+  return chunk->data + (offset - chunk->base);
+}
+
+/*
+ * Map the records written since the last chunk. A chunk always ends where
+ * a record does, so every record is in exactly one of them. The mapping
+ * starts at the page the first of them is on.
+ */
+static gboolean
+map_chunk (ScratchpadJournal *journal)
+{
+  ScratchpadJournalPrivate *priv;
+  Chunk chunk;
+  gpointer data;
+  glong page_size;
+  gint fd;
+  
+  priv = SCRATCHPAD_JOURNAL_GET_PRIVATE (journal);
+  
+  chunk.start = 0;
+  if (priv->chunks->len > 0)
+    chunk.start = g_array_index (priv->chunks, Chunk, priv->chunks->len - 1).end;
+  chunk.end = priv->journal_size;
+  
+  if (chunk.end <= chunk.start)
+    return FALSE;
+  
+  page_size = sysconf (_SC_PAGESIZE);
+  chunk.base = chunk.start - chunk.start % page_size;
+  
+  fd = g_open (priv->file_path, O_RDONLY, 0);
+  if (fd == -1)
+    return FALSE;
+  
+  data = mmap (NULL, chunk.end - chunk.base, PROT_READ, MAP_PRIVATE, fd, chunk.base);
+  close (fd);
+  
+  if (data == MAP_FAILED)
+    return FALSE;
+  
+  chunk.data = data;
+  g_array_append_val (priv->chunks, chunk);
+  
+  return TRUE;
+}
+
+static guint32
+read_guint32 (const gchar *data)
+{
+  guint32 value;
+  memcpy (&value, data, 4);
+  return GUINT32_FROM_LE (value);
+}
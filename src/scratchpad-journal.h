@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_JOURNAL_H__
+#define	__SCRATCHPAD_JOURNAL_H__
+
+#include <gtk/gtk.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_JOURNAL_TYPE            (scratchpad_journal_get_type ())
+#define SCRATCHPAD_JOURNAL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_JOURNAL_TYPE, ScratchpadJournal))
+#define SCRATCHPAD_JOURNAL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_JOURNAL_TYPE, ScratchpadJournalClass))
+#define IS_SCRATCHPAD_JOURNAL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_JOURNAL_TYPE))
+#define IS_SCRATCHPAD_JOURNAL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_JOURNAL_TYPE))
+
+typedef struct _ScratchpadJournal ScratchpadJournal;
+typedef struct _ScratchpadJournalClass ScratchpadJournalClass;
+
+struct _ScratchpadJournal
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadJournalClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_journal_get_type (void) G_GNUC_CONST;
+
+ScratchpadJournal*  scratchpad_journal_new         (const gchar       *file_path);
+
+guint               scratchpad_journal_get_length  (ScratchpadJournal *journal);
+gboolean            scratchpad_journal_is_removed  (ScratchpadJournal *journal,
+                                                    guint              record);
+guint               scratchpad_journal_append      (ScratchpadJournal *journal,
+                                                    ScratchpadSnippet *snippet);
+void                scratchpad_journal_remove      (ScratchpadJournal *journal,
+                                                    guint              record);
+gboolean            scratchpad_journal_read        (ScratchpadJournal *journal,
+                                                    ScratchpadSnippet *snippet);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_JOURNAL_H__ */
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "scratchpad-links.h"
+
+/*
+ * The header links of the pane, kept in a treap ordered by where they
+ * start in the buffer. A node holds its start relative to the start of 
+ * its parent, and only the root holds a buffer offset. Text put in or 
+ * taken out moves every link after it, which is done by splitting the 
+ * tree at the edit and changing the offset of the root of the half that
+ * comes after it, so an edit costs the same however many links follow.
+ */
+
+typedef struct _Node Node;
+
+struct _Node
+{
+  ScratchpadLink  link;
+  gint            offset;
+  gint            length;
+  guint32         priority;
+  Node           *left;
+  Node           *right;
+};
+
+static void scratchpad_links_class_init  (ScratchpadLinksClass *klass);
+static void scratchpad_links_init        (ScratchpadLinks      *links);
+static void scratchpad_links_finalize    (ScratchpadLinks      *links);
+
+static void split                        (Node                 *root,
+                                          gint                  offset,
+                                          Node                **before,
+                                          Node                **after);
+static Node* merge                       (Node                 *before,
+                                          Node                 *after);
+static Node* drop_overlap                (Node                 *root,
+                                          gint                  offset);
+static Node* remove_last                 (Node                 *root);
+static void free_nodes                   (Node                 *root);
+
+#define SCRATCHPAD_LINKS_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_LINKS_TYPE, ScratchpadLinksPrivate))
+
+typedef struct _ScratchpadLinksPrivate ScratchpadLinksPrivate;
+
+struct _ScratchpadLinksPrivate
+{
+  Node *root;
+};
+
+G_DEFINE_TYPE (ScratchpadLinks, scratchpad_links, G_TYPE_OBJECT)
+
+static void
+scratchpad_links_class_init (ScratchpadLinksClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_links_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadLinksPrivate));
+}
+
+static void
+scratchpad_links_init (ScratchpadLinks *links) 
+{
+  ScratchpadLinksPrivate *priv;
+  priv = SCRATCHPAD_LINKS_GET_PRIVATE (links);
+  priv->root = NULL;
+}
+
+static void
+scratchpad_links_finalize (ScratchpadLinks *links)
+{
+  ScratchpadLinksPrivate *priv;
+  priv = SCRATCHPAD_LINKS_GET_PRIVATE (links);
+  free_nodes (priv->root);
+  G_OBJECT_CLASS (scratchpad_links_parent_class)->finalize (G_OBJECT (links));
+}
+
+ScratchpadLinks*
+scratchpad_links_new (void)
+{
+  return SCRATCHPAD_LINKS (g_object_new (scratchpad_links_get_type (), NULL));
+}
+
+/*
+ * A link over the length characters at the offset. The header it is on 
+ * was just put in, so no other link starts inside of it.
+ */
+void
+scratchpad_links_add (ScratchpadLinks *links,
+                      gint             offset,
+                      gint             length,
+                      const gchar     *file_path,
+                      gint             line_number,
+                      guint            id)
+{
+  ScratchpadLinksPrivate *priv;
+  Node *before;
+  Node *after;
+  Node *node;
+
+  priv = SCRATCHPAD_LINKS_GET_PRIVATE (links);
+  
+  node = g_slice_new (Node);
+  node->link.file_path = file_path;
+  node->link.line_number = line_number;
+  node->link.id = id;
+  node->offset = offset;
+  node->length = length;
+  node->priority = g_random_int ();
+  node->left = NULL;
+  node->right = NULL;
+  
+  split (priv->root, offset, &before, &after);
+  priv->root = merge (merge (before, node), after);
+}
+
+/*
+ * The link under the offset, or NULL.
+ */
+ScratchpadLink*
+scratchpad_links_find (ScratchpadLinks *links,
+                       gint             offset)
+{
+  ScratchpadLinksPrivate *priv;
+  Node *node;
+  Node *found = NULL;
+  gint found_start = 0;
+  gint start = 0;
+
+  priv = SCRATCHPAD_LINKS_GET_PRIVATE (links);
+  
+  /* the last link starting at or before the offset */
+  node = priv->root;
+  while (node != NULL)
+    {
+      start += node->offset;
+      if (start <= offset)
+        {
+          found = node;
+          found_start = start;
+          node = node->right;
+        }
+      else
+        {
+          node = node->left;
+        }
+    }
+  
+  if (found != NULL && offset < found_start + found->length)
+    return &found->link;
+  
+  return NULL;
+}
+
+/*
+ * Text of the length was put in at the offset. A link that it went into
+ * the middle of is no longer a valid path, one that starts right there 
+ * moves along with the rest.
+ */
+void
+scratchpad_links_insert (ScratchpadLinks *links,
+                         gint             offset,
+                         gint             length)
+{
+  ScratchpadLinksPrivate *priv;
+  Node *before;
+  Node *after;
+
+  priv = SCRATCHPAD_LINKS_GET_PRIVATE (links);
+  
+  split (priv->root, offset, &before, &after);
+  
+  before = drop_overlap (before, offset);
+  if (after != NULL)
+    after->offset += length;
+  
+  priv->root = merge (before, after);
+}
+
+/*
+ * The text between the offsets was taken out. Every link that had any of
+ * it goes, and the ones after it move back.
+ */
+void
+scratchpad_links_delete (ScratchpadLinks *links,
+                         gint             start_offset,
+                         gint             end_offset)
+{
+  ScratchpadLinksPrivate *priv;
+  Node *before;
+  Node *deleted;
+  Node *after;
+
+  priv = SCRATCHPAD_LINKS_GET_PRIVATE (links);
+  
+  split (priv->root, start_offset, &before, &after);
+  split (after, end_offset, &deleted, &after);
+  free_nodes (deleted);
+  
+  before = drop_overlap (before, start_offset);
+  if (after != NULL)
+    after->offset += start_offset - end_offset;
+  
+  priv->root = merge (before, after);
+}
+
+/*
+ * Split the tree into the links that start before the offset and the 
+ * rest. The offset of a subtree root is made absolute while it is on its
+ * own and relative again once it is hung under another node.
+ */
+static void
+split (Node  *root,
+       gint   offset,
+       Node **before,
+       Node **after)
+{
+  Node *child;
+  Node *lower;
+  Node *upper;
+
+  if (root == NULL)
+    {
+      *before = NULL;
+      *after = NULL;
+      return;
+    }
+  
+  if (root->offset < offset)
+    {
+      child = root->right;
+      if (child != NULL)
+        child->offset += root->offset;
+      split (child, offset, &lower, &upper);
+      if (lower != NULL)
+        lower->offset -= root->offset;
+      root->right = lower;
+      *before = root;
+      *after = upper;
+    }
+  else
+    {
+      child = root->left;
+      if (child != NULL)
+        child->offset += root->offset;
+      split (child, offset, &lower, &upper);
+      if (upper != NULL)
+        upper->offset -= root->offset;
+      root->left = upper;
+      *before = lower;
+      *after = root;
+    }
+}
+
+/*
+ * Join two trees where every link in the first comes before every link 
+ * in the second. Both roots hold absolute offsets, and so does the result.
+ */
+static Node*
+merge (Node *before,
+       Node *after)
+{
+  Node *child;
+
+  if (before == NULL)
+    return after;
+  if (after == NULL)
+    return before;
+  
+  if (before->priority > after->priority)
+    {
+      child = before->right;
+      if (child != NULL)
+        child->offset += before->offset;
+      child = merge (child, after);
+      child->offset -= before->offset;
+      before->right = child;
+      return before;
+    }
+  
+  child = after->left;
+  if (child != NULL)
+    child->offset += after->offset;
+  child = merge (before, child);
+  child->offset -= after->offset;
+  after->left = child;
+  return after;
+}
+
+/*
+ * Every link in the tree starts before the offset, and only the last one
+ * can run over it.
+ */
+static Node*
+drop_overlap (Node *root,
+              gint  offset)
+{
+  Node *node;
+  gint start = 0;
+
+  for (node = root; node != NULL && node->right != NULL; node = node->right)
+    start += node->offset;
+  
+  if (node != NULL && start + node->offset + node->length > offset)
+    return remove_last (root);
+
+  return root;
+}
+
+static Node*
+remove_last (Node *root)
+{
+  Node *child;
+
+  if (root->right == NULL)
+    {
+      child = root->left;
+      if (child != NULL)
+        child->offset += root->offset;
+      g_slice_free (Node, root);
+      return child;
+    }
+  
+  child = root->right;
+  child->offset += root->offset;
+  child = remove_last (child);
+  if (child != NULL)
+    child->offset -= root->offset;
+  root->right = child;
+  return root;
+}
+
+static void
+free_nodes (Node *root)
+{
+  if (root == NULL)
+    return;
+  
+  free_nodes (root->left);
+  free_nodes (root->right);
+  g_slice_free (Node, root);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_LINKS_H__
+#define	__SCRATCHPAD_LINKS_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_LINKS_TYPE            (scratchpad_links_get_type ())
+#define SCRATCHPAD_LINKS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_LINKS_TYPE, ScratchpadLinks))
+#define SCRATCHPAD_LINKS_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_LINKS_TYPE, ScratchpadLinksClass))
+#define IS_SCRATCHPAD_LINKS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_LINKS_TYPE))
+#define IS_SCRATCHPAD_LINKS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_LINKS_TYPE))
+
+typedef struct _ScratchpadLinks ScratchpadLinks;
+typedef struct _ScratchpadLinksClass ScratchpadLinksClass;
+
+typedef struct
+{
+  const gchar *file_path;
+  gint         line_number;
+  guint        id;
+} ScratchpadLink;
+
+struct _ScratchpadLinks
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadLinksClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_links_get_type (void) G_GNUC_CONST;
+
+ScratchpadLinks*  scratchpad_links_new     (void);
+
+void              scratchpad_links_add     (ScratchpadLinks *links,
+                                            gint             offset,
+                                            gint             length,
+                                            const gchar     *file_path,
+                                            gint             line_number,
+                                            guint            id);
+ScratchpadLink*   scratchpad_links_find    (ScratchpadLinks *links,
+                                            gint             offset);
+void              scratchpad_links_insert  (ScratchpadLinks *links,
+                                            gint             offset,
+                                            gint             length);
+void              scratchpad_links_delete  (ScratchpadLinks *links,
+                                            gint             start_offset,
+                                            gint             end_offset);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_LINKS_H__ */
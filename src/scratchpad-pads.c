@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-pads.h"
+#include "scratchpad-journal.h"
+#include "scratchpad-stats.h"
+
+/*
+ * Every pad is a journal on disk. The default pad keeps the journal it
+ * always had and the named ones are in the pads folder next to it. Only
+ * the active pad has a pane, the others are just their journal, which is
+ * not even opened until the pad is first switched to. Switching throws
+ * the old pane away and restores the new one straight from its journal.
+ * Until the pads are first shown or captured to they are an empty box, 
+ * so a session that never uses them pays nothing for them.
+ */
+
+static void scratchpad_pads_class_init  (ScratchpadPadsClass *klass);
+static void scratchpad_pads_init        (ScratchpadPads      *pads);
+static void scratchpad_pads_finalize    (ScratchpadPads      *pads);
+
+static void create_combo                (ScratchpadPads      *pads);
+static void open_pads                   (ScratchpadPads      *pads);
+static gboolean is_valid_name           (const gchar         *name);
+static ScratchpadJournal* get_journal   (ScratchpadPads      *pads,
+                                         const gchar         *name);
+static void list_pads                   (ScratchpadPads      *pads);
+static void popup_shown_action          (ScratchpadPads      *pads);
+static void changed_action              (ScratchpadPads      *pads);
+static void activate_action             (ScratchpadPads      *pads);
+
+#define SCRATCHPAD_PADS_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_PADS_TYPE, ScratchpadPadsPrivate))
+
+typedef struct _ScratchpadPadsPrivate ScratchpadPadsPrivate;
+
+struct _ScratchpadPadsPrivate
+{
+  CodeSlayer         *codeslayer;
+  CodeSlayerRegistry *registry;
+  gchar              *folder_path;
+  gchar              *pads_path;
+  GtkWidget          *combo;
+  GtkWidget          *pane;
+  gchar              *name;
+  GHashTable         *journals;
+  gboolean            listed;
+};
+
+G_DEFINE_TYPE (ScratchpadPads, scratchpad_pads, GTK_TYPE_VBOX)
+
+static void
+scratchpad_pads_class_init (ScratchpadPadsClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_pads_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadPadsPrivate));
+}
+
+static void
+scratchpad_pads_init (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  priv->combo = NULL;
+  priv->pane = NULL;
+  priv->name = NULL;
+  priv->listed = FALSE;
+  priv->journals = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_object_unref);
+
+  g_signal_connect (G_OBJECT (pads), "map",
+                    G_CALLBACK (open_pads), NULL);
+}
+
+static void
+create_combo (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  GtkWidget *entry;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  priv->combo = gtk_combo_box_text_new_with_entry ();
+  entry = gtk_bin_get_child (GTK_BIN (priv->combo));
+  gtk_entry_set_placeholder_text (GTK_ENTRY (entry), "Pad");
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (priv->combo), SCRATCHPAD_DEFAULT_PAD);
+
+  g_signal_connect_swapped (G_OBJECT (priv->combo), "notify::popup-shown",
+                            G_CALLBACK (popup_shown_action), pads);
+  g_signal_connect_swapped (G_OBJECT (priv->combo), "changed",
+                            G_CALLBACK (changed_action), pads);
+  g_signal_connect_swapped (G_OBJECT (entry), "activate",
+                            G_CALLBACK (activate_action), pads);
+
+  gtk_box_pack_start (GTK_BOX (pads), priv->combo, FALSE, FALSE, 0);
+  gtk_widget_show_all (priv->combo);
+}
+
+static void
+scratchpad_pads_finalize (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  g_hash_table_destroy (priv->journals);
+  g_free (priv->folder_path);
+  g_free (priv->pads_path);
+  g_free (priv->name);
+
+  G_OBJECT_CLASS (scratchpad_pads_parent_class)->finalize (G_OBJECT(pads));
+}
+
+GtkWidget*
+scratchpad_pads_new (CodeSlayer  *codeslayer,
+                     const gchar *folder_path)
+{
+  ScratchpadPadsPrivate *priv;
+  GtkWidget *pads;
+
+  pads = g_object_new (scratchpad_pads_get_type (), NULL);
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+  priv->codeslayer = codeslayer;
+  priv->registry = codeslayer_get_registry (codeslayer);
+  priv->folder_path = g_strdup (folder_path);
+  priv->pads_path = g_build_filename (folder_path, "pads", NULL);
+
+  return pads;
+}
+
+/*
+ * Only the pad that was active last time is materialized, so opening
+ * costs the same no matter how many pads there are.
+ */
+static void
+open_pads (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  gchar *name;
+  gint64 start_time;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  if (priv->pane != NULL)
+    return;
+
+  start_time = SCRATCHPAD_STATS_START ();
+
+  name = codeslayer_registry_get_string (priv->registry, SCRATCHPAD_ACTIVE_PAD);
+  if (!scratchpad_pads_switch (pads, name))
+    scratchpad_pads_switch (pads, SCRATCHPAD_DEFAULT_PAD);
+  g_free (name);
+
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_OPEN, start_time);
+}
+
+/*
+ * The pane of the active pad, which opens the pads if they are not yet.
+ */
+ScratchpadPane*
+scratchpad_pads_get_pane (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+  open_pads (pads);
+  return SCRATCHPAD_PANE (priv->pane);
+}
+
+gboolean
+scratchpad_pads_is_open (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+  return priv->pane != NULL;
+}
+
+const gchar*
+scratchpad_pads_get_name (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+  return priv->name;
+}
+
+/*
+ * Make the named pad the active one, creating it if there is no such pad
+ * yet. Snippets that are still on their way to the old pad are already in
+ * its journal, so nothing is lost by dropping its pane.
+ */
+gboolean
+scratchpad_pads_switch (ScratchpadPads *pads,
+                        const gchar    *name)
+{
+  ScratchpadPadsPrivate *priv;
+  ScratchpadJournal *journal;
+  GtkWidget *entry;
+  gchar *active;
+  gint64 start_time;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  if (!is_valid_name (name))
+    return FALSE;
+
+  if (priv->pane != NULL && g_strcmp0 (priv->name, name) == 0)
+    return TRUE;
+
+  start_time = SCRATCHPAD_STATS_START ();
+
+  if (priv->combo == NULL)
+    create_combo (pads);
+
+  if (priv->listed && !g_hash_table_contains (priv->journals, name))
+    {
+      gchar *path = g_build_filename (priv->pads_path, name, NULL);
+      if (strcmp (name, SCRATCHPAD_DEFAULT_PAD) != 0 && !g_file_test (path, G_FILE_TEST_EXISTS))
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (priv->combo), name);
+      g_free (path);
+    }
+
+  journal = get_journal (pads, name);
+
+  if (priv->pane != NULL)
+    gtk_widget_destroy (priv->pane);
+
+  priv->pane = scratchpad_pane_new (priv->codeslayer);
+  scratchpad_pane_restore (SCRATCHPAD_PANE (priv->pane), journal);
+  gtk_box_pack_start (GTK_BOX (pads), priv->pane, TRUE, TRUE, 0);
+  gtk_widget_show_all (priv->pane);
+
+  g_free (priv->name);
+  priv->name = g_strdup (name);
+
+  entry = gtk_bin_get_child (GTK_BIN (priv->combo));
+  if (g_strcmp0 (gtk_entry_get_text (GTK_ENTRY (entry)), name) != 0)
+    gtk_entry_set_text (GTK_ENTRY (entry), name);
+
+  active = codeslayer_registry_get_string (priv->registry, SCRATCHPAD_ACTIVE_PAD);
+  if (g_strcmp0 (active, name) != 0)
+    codeslayer_registry_set_string (priv->registry, SCRATCHPAD_ACTIVE_PAD, name);
+  g_free (active);
+
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_SWITCH, start_time);
+
+  return TRUE;
+}
+
+/*
+ * The name is used as a file name as is.
+ */
+static gboolean
+is_valid_name (const gchar *name)
+{
+  return name != NULL && *name != '\0' && *name != '.' &&
+         strchr (name, G_DIR_SEPARATOR) == NULL &&
+         !g_str_has_suffix (name, ".index");
+}
+
+/*
+ * A journal stays open once its pad has been used, a capture that is
+ * still being written to it may be holding on to it anyway.
+ */
+static ScratchpadJournal*
+get_journal (ScratchpadPads *pads,
+             const gchar    *name)
+{
+  ScratchpadPadsPrivate *priv;
+  ScratchpadJournal *journal;
+  gchar *file_path;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  journal = g_hash_table_lookup (priv->journals, name);
+  if (journal != NULL)
+    return journal;
+
+  if (strcmp (name, SCRATCHPAD_DEFAULT_PAD) == 0)
+    file_path = g_build_filename (priv->folder_path, "journal", NULL);
+  else
+    file_path = g_build_filename (priv->pads_path, name, NULL);
+
+  journal = scratchpad_journal_new (file_path);
+  g_hash_table_insert (priv->journals, g_strdup (name), journal);
+  g_free (file_path);
+
+  return journal;
+}
+
+/*
+ * The pads folder is not read until somebody opens the list.
+ */
+static void
+list_pads (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  const gchar *file_name;
+  GDir *dir;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  priv->listed = TRUE;
+
+  dir = g_dir_open (priv->pads_path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((file_name = g_dir_read_name (dir)) != NULL)
+    {
+      if (is_valid_name (file_name) && strcmp (file_name, SCRATCHPAD_DEFAULT_PAD) != 0)
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (priv->combo), file_name);
+    }
+
+  g_dir_close (dir);
+}
+
+static void
+popup_shown_action (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+  if (!priv->listed)
+    list_pads (pads);
+}
+
+/*
+ * Typing in the entry changes the combo too, only picking a pad from the
+ * list switches to it.
+ */
+static void
+changed_action (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  gchar *name;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  if (gtk_combo_box_get_active (GTK_COMBO_BOX (priv->combo)) == -1)
+    return;
+
+  name = gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (priv->combo));
+  scratchpad_pads_switch (pads, name);
+  g_free (name);
+}
+
+static void
+activate_action (ScratchpadPads *pads)
+{
+  ScratchpadPadsPrivate *priv;
+  GtkWidget *entry;
+
+  priv = SCRATCHPAD_PADS_GET_PRIVATE (pads);
+
+  entry = gtk_bin_get_child (GTK_BIN (priv->combo));
+  if (!scratchpad_pads_switch (pads, gtk_entry_get_text (GTK_ENTRY (entry))))
+    gtk_entry_set_text (GTK_ENTRY (entry), priv->name);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_PADS_H__
+#define	__SCRATCHPAD_PADS_H__
+
+#include <gtk/gtk.h>
+#include <codeslayer/codeslayer.h>
+#include "scratchpad-pane.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_ACTIVE_PAD "scratchpad_active_pad"
+#define SCRATCHPAD_DEFAULT_PAD "Default"
+
+#define SCRATCHPAD_PADS_TYPE            (scratchpad_pads_get_type ())
+#define SCRATCHPAD_PADS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_PADS_TYPE, ScratchpadPads))
+#define SCRATCHPAD_PADS_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_PADS_TYPE, ScratchpadPadsClass))
+#define IS_SCRATCHPAD_PADS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_PADS_TYPE))
+#define IS_SCRATCHPAD_PADS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_PADS_TYPE))
+
+typedef struct _ScratchpadPads ScratchpadPads;
+typedef struct _ScratchpadPadsClass ScratchpadPadsClass;
+
+struct _ScratchpadPads
+{
+  GtkVBox parent_instance;
+};
+
+struct _ScratchpadPadsClass
+{
+  GtkVBoxClass parent_class;
+};
+
+GType scratchpad_pads_get_type (void) G_GNUC_CONST;
+
+GtkWidget*       scratchpad_pads_new        (CodeSlayer     *codeslayer,
+                                             const gchar    *folder_path);
+
+ScratchpadPane*  scratchpad_pads_get_pane   (ScratchpadPads *pads);
+
+gboolean         scratchpad_pads_is_open    (ScratchpadPads *pads);
+
+const gchar*     scratchpad_pads_get_name   (ScratchpadPads *pads);
+
+gboolean         scratchpad_pads_switch     (ScratchpadPads *pads,
+                                             const gchar    *name);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_PADS_H__ */
@@ -0,0 +1,712 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-palette.h"
+#include "scratchpad-stats.h"
+
+/*
+ * The index behind the jump palette. Every snippet has one line in it, 
+ * the header and then the first line of the body, and the lines are kept 
+ * back to back in one string along with a mask of the characters in each. 
+ * A query only scores the lines whose mask has all of its characters, and 
+ * a query that was typed onto the last one only looks at what that one
+ * matched, plus anything listed since.
+ */
+
+typedef struct
+{
+  guint    id;
+  guint    offset;
+  guint    length;
+  guint    header_length;
+  guint64  mask;
+  gboolean removed;
+} Entry;
+
+typedef struct
+{
+  gint  score;
+  guint index;
+} Hit;
+
+static void scratchpad_palette_class_init  (ScratchpadPaletteClass *klass);
+static void scratchpad_palette_init        (ScratchpadPalette      *palette);
+static void scratchpad_palette_finalize    (ScratchpadPalette      *palette);
+
+static void set_label                      (ScratchpadPalette      *palette,
+                                            Entry                  *entry,
+                                            const gchar            *header,
+                                            gsize                   header_length,
+                                            const gchar            *line,
+                                            gsize                   line_length);
+static void waste_label                    (ScratchpadPalette      *palette,
+                                            guint                   length);
+static void compact                        (ScratchpadPalette      *palette);
+static void backfill                       (ScratchpadPalette      *palette);
+static void forget_query                   (ScratchpadPalette      *palette);
+static gint find_entry                     (ScratchpadPalette      *palette,
+                                            guint                   id);
+static gint entry_compare                  (Entry                  *entry1,
+                                            Entry                  *entry2);
+static guint64 text_mask                   (const gchar            *text,
+                                            gsize                   length);
+static gchar* fold_query                   (const gchar            *query);
+static gint score_label                    (const gchar            *label,
+                                            guint                   length,
+                                            const gchar            *query,
+                                            guint                   query_length);
+static gboolean is_boundary                (const gchar            *label,
+                                            guint                   i);
+static void keep_hit                       (GArray                 *hits,
+                                            gint                    score,
+                                            guint                   index,
+                                            guint                   limit);
+
+#define SCRATCHPAD_PALETTE_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_PALETTE_TYPE, ScratchpadPalettePrivate))
+
+#define FOLD(c) g_ascii_tolower (c)
+
+/* enough of the first line to tell the snippets apart */
+#define MAX_LINE 80
+
+/* removed and moved lines are left in the string until there are this many bytes of them */
+#define MAX_WASTE (256 * 1024)
+
+#define SCORE_MATCH 16
+#define SCORE_CONSECUTIVE 12
+#define SCORE_BOUNDARY 10
+#define MAX_GAP_PENALTY 8
+
+typedef struct _ScratchpadPalettePrivate ScratchpadPalettePrivate;
+
+struct _ScratchpadPalettePrivate
+{
+  ScratchpadStore *store;
+  GArray          *entries;
+  GString         *labels;
+  guint            count;
+  gsize            waste;
+  gchar           *query;
+  GArray          *candidates;
+  guint            scanned;
+};
+
+G_DEFINE_TYPE (ScratchpadPalette, scratchpad_palette, G_TYPE_OBJECT)
+
+static void
+scratchpad_palette_class_init (ScratchpadPaletteClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_palette_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadPalettePrivate));
+}
+
+static void
+scratchpad_palette_init (ScratchpadPalette *palette) 
+{
+  ScratchpadPalettePrivate *priv;
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  priv->entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+  priv->labels = g_string_new (NULL);
+  priv->count = 0;
+  priv->waste = 0;
+  priv->query = NULL;
+  priv->candidates = NULL;
+  priv->scanned = 0;
+}
+
+static void
+scratchpad_palette_finalize (ScratchpadPalette *palette)
+{
+  ScratchpadPalettePrivate *priv;
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  forget_query (palette);
+  g_array_unref (priv->entries);
+  g_string_free (priv->labels, TRUE);
+  G_OBJECT_CLASS (scratchpad_palette_parent_class)->finalize (G_OBJECT (palette));
+}
+
+ScratchpadPalette*
+scratchpad_palette_new (ScratchpadStore *store)
+{
+  ScratchpadPalettePrivate *priv;
+  ScratchpadPalette *palette;
+
+  palette = SCRATCHPAD_PALETTE (g_object_new (scratchpad_palette_get_type (), NULL));
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  priv->store = store;
+
+  return palette;
+}
+
+void
+scratchpad_palette_add (ScratchpadPalette *palette,
+                        ScratchpadSnippet *snippet)
+{
+  ScratchpadPalettePrivate *priv;
+  const gchar *line;
+  const gchar *end;
+  gchar *header;
+  Entry entry;
+
+  if (snippet->listed)
+    return;
+  
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  /* the first line that has anything on it */
+  line = snippet->text;
+  while (g_ascii_isspace (*line))
+    line++;
+  
+  end = line;
+  while (*end != '\0' && *end != '\n' && end - line < MAX_LINE)
+    end = g_utf8_next_char (end);
+  while (end > line && g_ascii_isspace (end[-1]))
+    end--;
+  
+  header = scratchpad_store_get_header (snippet);
+  
+  entry.id = snippet->id;
+  entry.removed = FALSE;
+  set_label (palette, &entry, header, strlen (header), line, end - line);
+  g_array_append_val (priv->entries, entry);
+  priv->count++;
+  
+  g_free (header);
+
+  snippet->listed = TRUE;
+}
+
+void
+scratchpad_palette_remove (ScratchpadPalette *palette,
+                           guint              id)
+{
+  ScratchpadPalettePrivate *priv;
+  Entry *entry;
+  gint index;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  index = find_entry (palette, id);
+  if (index < 0)
+    return;
+  
+  entry = &g_array_index (priv->entries, Entry, index);
+  if (entry->removed)
+    return;
+  
+  entry->removed = TRUE;
+  priv->count--;
+  
+  waste_label (palette, entry->length);
+}
+
+/*
+ * The snippet has moved to another line. The first line of the body is 
+ * taken from the old label since the text may not be loaded.
+ */
+void
+scratchpad_palette_set_line (ScratchpadPalette *palette,
+                             ScratchpadSnippet *snippet)
+{
+  ScratchpadPalettePrivate *priv;
+  Entry *entry;
+  gchar *header;
+  gchar *line;
+  guint length;
+  gint index;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  index = find_entry (palette, snippet->id);
+  if (index < 0)
+    return;
+  
+  entry = &g_array_index (priv->entries, Entry, index);
+  if (entry->removed)
+    return;
+  
+  length = entry->length;
+  line = g_strdup (priv->labels->str + entry->offset + MIN (entry->header_length + 2, length));
+  header = scratchpad_store_get_header (snippet);
+  
+  set_label (palette, entry, header, strlen (header), line, strlen (line));
+  
+  g_free (header);
+  g_free (line);
+  
+  /* what the last query matched may not match any more */
+  forget_query (palette);
+  waste_label (palette, length);
+}
+
+static void
+set_label (ScratchpadPalette *palette,
+           Entry             *entry,
+           const gchar       *header,
+           gsize              header_length,
+           const gchar       *line,
+           gsize              line_length)
+{
+  ScratchpadPalettePrivate *priv;
+  
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  entry->offset = priv->labels->len;
+  entry->header_length = header_length;
+  
+  g_string_append_len (priv->labels, header, header_length);
+  if (line_length > 0)
+    {
+      g_string_append (priv->labels, "  ");
+      g_string_append_len (priv->labels, line, line_length);
+    }
+  
+  entry->length = priv->labels->len - entry->offset;
+  g_string_append_c (priv->labels, '\0');
+  
+  entry->mask = text_mask (priv->labels->str + entry->offset, entry->length);
+}
+
+static void
+waste_label (ScratchpadPalette *palette,
+             guint              length)
+{
+  ScratchpadPalettePrivate *priv;
+  
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  priv->waste += length + 1;
+  
+  if (priv->waste > MAX_WASTE && priv->waste > priv->labels->len / 2)
+    compact (palette);
+}
+
+/*
+ * Pack the lines that are still wanted into a new string and drop the 
+ * removed entries. Entries move so the last query is no good after.
+ */
+static void
+compact (ScratchpadPalette *palette)
+{
+  ScratchpadPalettePrivate *priv;
+  GArray *entries;
+  GString *labels;
+  guint i;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  entries = g_array_sized_new (FALSE, FALSE, sizeof (Entry), priv->count);
+  labels = g_string_sized_new (priv->labels->len - priv->waste);
+  
+  for (i = 0; i < priv->entries->len; i++)
+    {
+      Entry entry = g_array_index (priv->entries, Entry, i);
+      if (entry.removed)
+        continue;
+      
+      g_string_append_len (labels, priv->labels->str + entry.offset, entry.length + 1);
+      entry.offset = labels->len - entry.length - 1;
+      g_array_append_val (entries, entry);
+    }
+  
+  g_array_unref (priv->entries);
+  g_string_free (priv->labels, TRUE);
+  priv->entries = entries;
+  priv->labels = labels;
+  priv->waste = 0;
+  
+  forget_query (palette);
+}
+
+/*
+ * Snippets restored from the journal are only listed once somebody opens 
+ * the palette, since that means reading every one of them. The label is 
+ * all that is kept so they are let go again as it goes.
+ */
+static void
+backfill (ScratchpadPalette *palette)
+{
+  ScratchpadPalettePrivate *priv;
+  guint length;
+  guint i;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  length = scratchpad_store_get_length (priv->store);
+  if (priv->count == length)
+    return;
+  
+  for (i = 0; i < length; i++)
+    {
+      scratchpad_palette_add (palette, scratchpad_store_get (priv->store, i));
+      if (i % SCRATCHPAD_STORE_TRIM_INTERVAL == SCRATCHPAD_STORE_TRIM_INTERVAL - 1)
+        scratchpad_store_trim (priv->store);
+    }
+  
+  /* the restored snippets are older than any captured since */
+  g_array_sort (priv->entries, (GCompareFunc) entry_compare);
+  forget_query (palette);
+}
+
+static void
+forget_query (ScratchpadPalette *palette)
+{
+  ScratchpadPalettePrivate *priv;
+  
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  g_free (priv->query);
+  priv->query = NULL;
+  
+  if (priv->candidates != NULL)
+    {
+      g_array_unref (priv->candidates);
+      priv->candidates = NULL;
+    }
+}
+
+/*
+ * Returns the ids of the best matches for the query, best first, with the 
+ * newer snippet first between two that score the same. An empty query 
+ * gives the newest snippets.
+ */
+GArray*
+scratchpad_palette_rank (ScratchpadPalette *palette,
+                         const gchar       *query,
+                         guint              limit)
+{
+  ScratchpadPalettePrivate *priv;
+  GArray *results;
+  GArray *hits;
+  GArray *matched;
+  gchar *folded;
+  guint query_length;
+  guint64 mask;
+  guint carried = 0;
+  guint from = 0;
+  guint total;
+  guint i;
+  gint64 start_time;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  start_time = SCRATCHPAD_STATS_START ();
+  
+  backfill (palette);
+  
+  results = g_array_sized_new (FALSE, FALSE, sizeof (guint), limit);
+  
+  folded = fold_query (query);
+  query_length = strlen (folded);
+  
+  if (query_length == 0)
+    {
+      for (i = priv->entries->len; i > 0 && results->len < limit; i--)
+        {
+          Entry *entry = &g_array_index (priv->entries, Entry, i - 1);
+          if (!entry->removed)
+            g_array_append_val (results, entry->id);
+        }
+      
+      forget_query (palette);
+      g_free (folded);
+      return results;
+    }
+  
+  /* typing onto the last query can only narrow down what it matched */
+  if (priv->query != NULL && g_str_has_prefix (folded, priv->query))
+    {
+      carried = priv->candidates->len;
+      from = priv->scanned;
+    }
+  
+  mask = text_mask (folded, query_length);
+  hits = g_array_sized_new (FALSE, FALSE, sizeof (Hit), limit + 1);
+  matched = g_array_new (FALSE, FALSE, sizeof (guint));
+  
+  total = carried + priv->entries->len - from;
+  for (i = 0; i < total; i++)
+    {
+      guint index;
+      Entry *entry;
+      gint score;
+      
+      if (i < carried)
+        index = g_array_index (priv->candidates, guint, i);
+      else
+        index = from + i - carried;
+      
+      entry = &g_array_index (priv->entries, Entry, index);
+      if (entry->removed || (entry->mask & mask) != mask)
+        continue;
+      
+      score = score_label (priv->labels->str + entry->offset, entry->length, 
+                           folded, query_length);
+      if (score < 0)
+        continue;
+      
+      g_array_append_val (matched, index);
+      keep_hit (hits, score, index, limit);
+    }
+  
+  for (i = 0; i < hits->len; i++)
+    {
+      Hit *hit = &g_array_index (hits, Hit, i);
+      guint id = g_array_index (priv->entries, Entry, hit->index).id;
+      g_array_append_val (results, id);
+    }
+  
+  forget_query (palette);
+  priv->query = folded;
+  priv->candidates = matched;
+  priv->scanned = priv->entries->len;
+  
+  g_array_unref (hits);
+  
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_PALETTE, start_time);
+
+  return results;
+}
+
+/*
+ * The line that the snippet is listed under, which is good until the next 
+ * change to the palette.
+ */
+const gchar*
+scratchpad_palette_get_label (ScratchpadPalette *palette,
+                              guint              id)
+{
+  ScratchpadPalettePrivate *priv;
+  Entry *entry;
+  gint index;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  index = find_entry (palette, id);
+  if (index < 0)
+    return NULL;
+  
+  entry = &g_array_index (priv->entries, Entry, index);
+  if (entry->removed)
+    return NULL;
+  
+  return priv->labels->str + entry->offset;
+}
+
+static gint
+find_entry (ScratchpadPalette *palette,
+            guint              id)
+{
+  ScratchpadPalettePrivate *priv;
+  guint low = 0;
+  guint high;
+
+  priv = SCRATCHPAD_PALETTE_GET_PRIVATE (palette);
+  
+  high = priv->entries->len;
+  while (low < high)
+    {
+      guint middle = low + (high - low) / 2;
+      guint middle_id = g_array_index (priv->entries, Entry, middle).id;
+      
+      if (middle_id == id)
+        return middle;
+      else if (middle_id < id)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+  
+  return -1;
+}
+
+static gint
+entry_compare (Entry *entry1,
+               Entry *entry2)
+{
+  if (entry1->id < entry2->id)
+    return -1;
+  return entry1->id > entry2->id;
+}
+
+/*
+ * Letters and digits get a bit each, folded the way the query is, and 
+ * everything else shares what is left.
+ */
+static guint64
+text_mask (const gchar *text,
+           gsize        length)
+{
+  guint64 mask = 0;
+  gsize i;
+  
+  for (i = 0; i < length; i++)
+    {
+      guchar c = FOLD (text[i]);
+      
+      if (c >= 'a' && c <= 'z')
+        mask |= G_GUINT64_CONSTANT (1) << (c - 'a');
+      else if (c >= '0' && c <= '9')
+        mask |= G_GUINT64_CONSTANT (1) << (26 + c - '0');
+      else
+        mask |= G_GUINT64_CONSTANT (1) << (36 + c % 28);
+    }
+  
+  return mask;
+}
+
+/*
+ * Spaces in the query only keep the words apart for whoever typed them.
+ */
+static gchar*
+fold_query (const gchar *query)
+{
+  gchar *folded;
+  gsize length = 0;
+  
+  folded = g_malloc (strlen (query) + 1);
+  
+  for (; *query != '\0'; query++)
+    {
+      if (*query != ' ')
+        folded[length++] = FOLD (*query);
+    }
+  
+  folded[length] = '\0';
+  
+  return folded;
+}
+
+/*
+ * Score the query as a subsequence of the label, or -1 when it is not one.
+ * The leftmost match is found going forward and then tightened by going 
+ * back from where it ended, so that letters scattered along the path do
+ * not win over the same letters together further on. Runs and the starts 
+ * of words count for more, and gaps count against.
+ */
+static gint
+score_label (const gchar *label,
+             guint        length,
+             const gchar *query,
+             guint        query_length)
+{
+  guint start, end;
+  guint i, j;
+  gint last = -1;
+  gint score = 0;
+  
+  for (i = 0, j = 0; i < length; i++)
+    {
+      if (FOLD (label[i]) == query[j] && ++j == query_length)
+        break;
+    }
+  
+  if (j < query_length)
+    return -1;
+  
+  end = i;
+  
+  for (;; i--)
+    {
+      if (FOLD (label[i]) == query[j - 1] && --j == 0)
+        break;
+    }
+  
+  start = i;
+  
+  for (i = start; i <= end && j < query_length; i++)
+    {
+      if (FOLD (label[i]) != query[j])
+        continue;
+      
+      score += SCORE_MATCH;
+      
+      if (last >= 0 && i == (guint) last + 1)
+        score += SCORE_CONSECUTIVE;
+      else if (last >= 0)
+        score -= MIN (i - last - 1, MAX_GAP_PENALTY);
+      
+      if (is_boundary (label, i))
+        score += SCORE_BOUNDARY;
+      
+      last = i;
+      j++;
+    }
+  
+  return score;
+}
+
+static gboolean
+is_boundary (const gchar *label,
+             guint        i)
+{
+  if (i == 0)
+    return TRUE;
+  
+  switch (label[i - 1])
+    {
+    case '/':
+    case '_':
+    case '-':
+    case '.':
+    case ':':
+    case ' ':
+      return TRUE;
+    }
+  
+  return g_ascii_islower (label[i - 1]) && g_ascii_isupper (label[i]);
+}
+
+/*
+ * Keep the best hits in order, best first. The entries are scored oldest 
+ * first so a hit goes ahead of any it ties with.
+ */
+static void
+keep_hit (GArray *hits,
+          gint    score,
+          guint   index,
+          guint   limit)
+{
+  guint low = 0;
+  guint high;
+  Hit hit;
+  
+  high = hits->len;
+  while (low < high)
+    {
+      guint middle = low + (high - low) / 2;
+      if (g_array_index (hits, Hit, middle).score > score)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+  
+  if (low >= limit)
+    return;
+  
+  hit.score = score;
+  hit.index = index;
+  g_array_insert_val (hits, low, hit);
+  
+  if (hits->len > limit)
+    g_array_set_size (hits, limit);
+}
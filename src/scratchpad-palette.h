@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_PALETTE_H__
+#define	__SCRATCHPAD_PALETTE_H__
+
+#include <gtk/gtk.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_PALETTE_TYPE            (scratchpad_palette_get_type ())
+#define SCRATCHPAD_PALETTE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_PALETTE_TYPE, ScratchpadPalette))
+#define SCRATCHPAD_PALETTE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_PALETTE_TYPE, ScratchpadPaletteClass))
+#define IS_SCRATCHPAD_PALETTE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_PALETTE_TYPE))
+#define IS_SCRATCHPAD_PALETTE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_PALETTE_TYPE))
+
+typedef struct _ScratchpadPalette ScratchpadPalette;
+typedef struct _ScratchpadPaletteClass ScratchpadPaletteClass;
+
+struct _ScratchpadPalette
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadPaletteClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_palette_get_type (void) G_GNUC_CONST;
+
+ScratchpadPalette*  scratchpad_palette_new        (ScratchpadStore   *store);
+
+void                scratchpad_palette_add        (ScratchpadPalette *palette,
+                                                   ScratchpadSnippet *snippet);
+void                scratchpad_palette_remove     (ScratchpadPalette *palette,
+                                                   guint              id);
+void                scratchpad_palette_set_line   (ScratchpadPalette *palette,
+                                                   ScratchpadSnippet *snippet);
+GArray*             scratchpad_palette_rank       (ScratchpadPalette *palette,
+                                                   const gchar       *query,
+                                                   guint              limit);
+const gchar*        scratchpad_palette_get_label  (ScratchpadPalette *palette,
+                                                   guint              id);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_PALETTE_H__ */
@@ -17,22 +17,134 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <gtksourceview/gtksourceview.h>
 #include "scratchpad-pane.h"
+#include "scratchpad-search.h"
+#include "scratchpad-palette.h"
+#include "scratchpad-diff.h"
+#include "scratchpad-anchor.h"
+#include "scratchpad-export.h"
+#include "scratchpad-highlighter.h"
+#include "scratchpad-stats.h"
+#include "scratchpad-undo.h"
+#include "scratchpad-links.h"
 
-typedef struct
+/* 
+ * In the virtual view only this many snippets around the viewport are 
+ * in the buffer, and scrolling near either edge brings in another step.
+ */
+#define WINDOW_SIZE 200
+#define WINDOW_STEP 50
+
+/* no point in painting more matches than anybody is going to look at */
+#define MAX_HIGHLIGHTS 1000
+
+/* snippets given syntax highlighting per idle callback */
+#define HIGHLIGHT_STEP 10
+
+/* matches listed in the jump palette */
+#define PALETTE_ROWS 50
+
+enum
 {
-  gchar *file_path;
-  gint   line_number;
-  gint   start_offset;
-  gint   end_offset;
-} Link;
+  PALETTE_LABEL = 0,
+  PALETTE_ID,
+  PALETTE_COLUMNS
+};
 
 static void scratchpad_pane_class_init  (ScratchpadPaneClass *klass);
 static void scratchpad_pane_init        (ScratchpadPane      *pane);
 static void scratchpad_pane_finalize    (ScratchpadPane      *pane);
 
 static void registry_changed_action     (ScratchpadPane      *pane);
+static gboolean apply_settings          (ScratchpadPane      *pane);
+static void load_view_mode              (ScratchpadPane      *pane);
+static gboolean parse_header            (const gchar         *header,
+                                         gchar              **file_path,
+                                         gint                *line_number);
+static void add_link                    (ScratchpadPane      *pane,
+                                         ScratchpadSnippet   *snippet,
+                                         gint                 start_offset,
+                                         gint                 length);
+static void render_snippet              (ScratchpadPane      *pane,
+                                         ScratchpadSnippet   *snippet,
+                                         gboolean             at_end);
+static void unrender_snippet            (ScratchpadPane      *pane,
+                                         guint                index);
+static gboolean take_out_snippet        (ScratchpadPane      *pane,
+                                         guint                index);
+static void trim_window                 (ScratchpadPane      *pane,
+                                         gboolean             from_top);
+static void grow_window                 (ScratchpadPane      *pane,
+                                         gboolean             upward);
+static void reset_window                (ScratchpadPane      *pane,
+                                         guint                index);
+static guint extend_window              (ScratchpadPane      *pane,
+                                         gboolean             upward);
+static gboolean restore_action          (ScratchpadPane      *pane);
+static void scroll_action               (ScratchpadPane      *pane,
+                                         GtkAdjustment       *adjustment);
+static ScratchpadSnippet* show_snippet  (ScratchpadPane      *pane,
+                                         ScratchpadSnippet   *snippet);
+static void follow_link                 (ScratchpadPane      *pane,
+                                         ScratchpadLink      *link);
+static void editor_saved_action         (ScratchpadPane      *pane,
+                                         CodeSlayerEditor    *editor);
+static gboolean relocate_snippet        (ScratchpadPane      *pane,
+                                         guint                index,
+                                         GtkTextBuffer       *buffer);
+static void rewrite_header              (ScratchpadPane      *pane,
+                                         ScratchpadSnippet   *snippet,
+                                         gint                 old_line_number);
+static void schedule_highlight          (ScratchpadPane      *pane);
+static gboolean highlight_action        (ScratchpadPane      *pane);
+static guint find_snippet_at            (ScratchpadPane      *pane,
+                                         gint                 offset);
+static void populate_popup_action       (ScratchpadPane      *pane,
+                                         GtkWidget           *popup);
+static void export_action               (ScratchpadPane      *pane);
+static void stats_action                (ScratchpadPane      *pane);
+static void search_changed_action       (ScratchpadPane      *pane);
+static void search_next_action          (ScratchpadPane      *pane);
+static void highlight_results           (ScratchpadPane      *pane);
+static void highlight_snippet           (ScratchpadPane      *pane,
+                                         ScratchpadSnippet   *snippet);
+static void get_body_iter               (ScratchpadPane      *pane,
+                                         ScratchpadSnippet   *snippet,
+                                         GtkTextIter         *iter);
+static void insert_text_action          (ScratchpadPane      *pane,
+                                         GtkTextIter         *iter,
+                                         gchar               *text,
+                                         gint                 len);
+static void delete_range_action         (ScratchpadPane      *pane,
+                                         GtkTextIter         *start,
+                                         GtkTextIter         *end);
+static gboolean button_release_action   (ScratchpadPane      *pane,
+                                         GdkEventButton      *event);
+static void create_palette              (ScratchpadPane      *pane);
+static gboolean key_press_action        (ScratchpadPane      *pane,
+                                         GdkEventKey         *event);
+static void open_palette                (ScratchpadPane      *pane);
+static void close_palette               (ScratchpadPane      *pane);
+static void palette_changed_action      (ScratchpadPane      *pane);
+static gboolean palette_key_action      (ScratchpadPane      *pane,
+                                         GdkEventKey         *event);
+static void move_palette_selection      (ScratchpadPane      *pane,
+                                         gint                 step);
+static void palette_activated_action    (ScratchpadPane      *pane);
+static void jump_to_snippet             (ScratchpadPane      *pane,
+                                         guint                id);
+static void create_diff_view            (ScratchpadPane      *pane);
+static ScratchpadSnippet* get_cursor_snippet (ScratchpadPane *pane);
+static void diff_source_action          (ScratchpadPane      *pane);
+static void mark_diff_action            (ScratchpadPane      *pane);
+static void diff_marked_action          (ScratchpadPane      *pane);
+static void open_diff                   (ScratchpadPane      *pane,
+                                         gchar               *title);
+static void close_diff                  (ScratchpadPane      *pane);
+static void diff_finished_action        (ScratchpadPane      *pane,
+                                         ScratchpadDiffResult *result);
 
 #define SCRATCHPAD_PANE_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_PANE_TYPE, ScratchpadPanePrivate))
@@ -43,11 +155,50 @@ struct _ScratchpadPanePrivate
 {
   CodeSlayer             *codeslayer;
   CodeSlayerRegistry     *registry;
-  CodeSlayerEditorLinker *linker;
   GtkWidget              *text_view;
+  GtkWidget              *search_entry;
+  GtkWidget              *palette_box;
+  GtkWidget              *palette_entry;
+  GtkWidget              *palette_view;
+  GtkListStore           *palette_list;
+  GtkWidget              *pad_window;
+  GtkWidget              *diff_box;
+  GtkWidget              *diff_label;
+  GtkWidget              *diff_view;
   GtkTextBuffer          *buffer;
+  ScratchpadStore        *store;
+  ScratchpadSearch       *search;
+  ScratchpadPalette      *palette;
+  ScratchpadDiff         *diff;
+  gchar                  *diff_title;
+  guint                   diff_base;
+  ScratchpadHighlighter  *highlighter;
+  ScratchpadUndo         *undo;
+  guint                   highlight_id;
+  gchar                  *query;
+  GArray                 *results;
+  guint                   result;
+  ScratchpadLinks        *links;
+  gboolean                adding;
+  gboolean                append;
+  gboolean                virtual;
+  gboolean                scrolling;
+  guint                   batch;
+  guint                   window_start;
+  guint                   window_end;
+  guint                   restore_id;
+  guint                   restore_show;
   gulong                  registry_initialized_id;
   gulong                  registry_changed_id;
+  gulong                  editor_saved_id;
+  guint                   registry_id;
+  gboolean                settings_applied;
+  gdouble                 editor_tab_width;
+  gboolean                enable_automatic_indentation;
+  gboolean                insert_spaces_instead_of_tabs;
+  gchar                  *fontname;
+  gdouble                 memory_budget;
+  gdouble                 undo_depth;
 };
 
 G_DEFINE_TYPE (ScratchpadPane, scratchpad_pane, GTK_TYPE_VBOX)
@@ -71,13 +222,72 @@ scratchpad_pane_init (ScratchpadPane *pane)
   priv->text_view = gtk_source_view_new ();
   priv->buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->text_view));
   gtk_text_buffer_create_tag (priv->buffer, "header", "weight", PANGO_WEIGHT_BOLD, NULL);
+  gtk_text_buffer_create_tag (priv->buffer, "link", "underline", PANGO_UNDERLINE_SINGLE, NULL);
+  gtk_text_buffer_create_tag (priv->buffer, "search", "background", "#fce94f", NULL);
+
+  priv->store = scratchpad_store_new ();
+  priv->search = scratchpad_search_new (priv->store);
+  priv->palette = scratchpad_palette_new (priv->store);
+  priv->diff = scratchpad_diff_new ();
+  priv->diff_title = NULL;
+  priv->diff_base = G_MAXUINT;
+  g_signal_connect_swapped (G_OBJECT (priv->diff), "finished",
+                            G_CALLBACK (diff_finished_action), pane);
+  priv->highlighter = scratchpad_highlighter_new (priv->buffer);
+  priv->undo = scratchpad_undo_new (pane, priv->buffer, priv->store);
+  gtk_source_buffer_set_undo_manager (GTK_SOURCE_BUFFER (priv->buffer), 
+                                      GTK_SOURCE_UNDO_MANAGER (priv->undo));
+  priv->highlight_id = 0;
+  priv->query = NULL;
+  priv->results = NULL;
+  priv->result = 0;
+  priv->links = scratchpad_links_new ();
+  priv->adding = FALSE;
+  priv->append = TRUE;
+  priv->virtual = FALSE;
+  priv->scrolling = FALSE;
+  priv->batch = 0;
+  priv->window_start = 0;
+  priv->window_end = 0;
+  priv->restore_id = 0;
+  priv->restore_show = G_MAXUINT;
+  priv->registry_id = 0;
+  priv->settings_applied = FALSE;
+  priv->fontname = NULL;
+
+  g_signal_connect_swapped (G_OBJECT (priv->buffer), "insert-text",
+                            G_CALLBACK (insert_text_action), pane);
+  g_signal_connect_swapped (G_OBJECT (priv->buffer), "delete-range",
+                            G_CALLBACK (delete_range_action), pane);
+  g_signal_connect_swapped (G_OBJECT (priv->text_view), "button-release-event",
+                            G_CALLBACK (button_release_action), pane);
+  g_signal_connect_swapped (G_OBJECT (priv->text_view), "populate-popup",
+                            G_CALLBACK (populate_popup_action), pane);
+  g_signal_connect_swapped (G_OBJECT (pane), "key-press-event",
+                            G_CALLBACK (key_press_action), pane);
+
+  priv->search_entry = gtk_entry_new ();
+  gtk_entry_set_placeholder_text (GTK_ENTRY (priv->search_entry), "Search");
+  g_signal_connect_swapped (G_OBJECT (priv->search_entry), "changed",
+                            G_CALLBACK (search_changed_action), pane);
+  g_signal_connect_swapped (G_OBJECT (priv->search_entry), "activate",
+                            G_CALLBACK (search_next_action), pane);
+  gtk_box_pack_start (GTK_BOX (pane), priv->search_entry, FALSE, FALSE, 0);
+  
+  create_palette (pane);
 
   scrolled_window = gtk_scrolled_window_new (NULL, NULL);
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
                                   GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
   gtk_container_add (GTK_CONTAINER (scrolled_window), priv->text_view);
+  
+  g_signal_connect_swapped (G_OBJECT (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (scrolled_window))), 
+                            "value-changed", G_CALLBACK (scroll_action), pane);
 
   gtk_box_pack_start (GTK_BOX (pane), scrolled_window, TRUE, TRUE, 0);
+  priv->pad_window = scrolled_window;
+  
+  create_diff_view (pane);
 }
 
 static void
@@ -88,8 +298,30 @@ scratchpad_pane_finalize (ScratchpadPane *pane)
 
   g_signal_handler_disconnect (priv->registry, priv->registry_initialized_id);
   g_signal_handler_disconnect (priv->registry, priv->registry_changed_id);
+  g_signal_handler_disconnect (priv->codeslayer, priv->editor_saved_id);
+  
+  if (priv->restore_id != 0)
+    g_source_remove (priv->restore_id);
+  
+  if (priv->registry_id != 0)
+    g_source_remove (priv->registry_id);
+  
+  if (priv->highlight_id != 0)
+    g_source_remove (priv->highlight_id);
   
-  g_object_unref (priv->linker);
+  g_free (priv->fontname);
+  g_object_unref (priv->links);
+  g_object_unref (priv->search);
+  g_object_unref (priv->palette);
+  g_object_unref (priv->diff);
+  g_free (priv->diff_title);
+  g_object_unref (priv->highlighter);
+  g_object_unref (priv->undo);
+  g_object_unref (priv->store);
+  g_free (priv->query);
+  
+  if (priv->results != NULL)
+    g_array_unref (priv->results);
   
   G_OBJECT_CLASS (scratchpad_pane_parent_class)->finalize (G_OBJECT(pane));
 }
@@ -104,8 +336,6 @@ scratchpad_pane_new (CodeSlayer *codeslayer)
   priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
   priv->codeslayer = codeslayer;
   priv->registry = codeslayer_get_registry (codeslayer);
-  
-  priv->linker = codeslayer_create_editor_linker (codeslayer, GTK_TEXT_VIEW (priv->text_view));
 
   priv->registry_initialized_id = g_signal_connect_swapped (G_OBJECT (priv->registry), "registry-initialized",
                                                               G_CALLBACK (registry_changed_action), SCRATCHPAD_PANE (pane));
@@ -113,73 +343,1987 @@ scratchpad_pane_new (CodeSlayer *codeslayer)
   priv->registry_changed_id = g_signal_connect_swapped (G_OBJECT (priv->registry), "registry-changed",
                                                         G_CALLBACK (registry_changed_action), SCRATCHPAD_PANE (pane));
   
+  priv->editor_saved_id = g_signal_connect_swapped (G_OBJECT (codeslayer), "editor-saved",
+                                                    G_CALLBACK (editor_saved_action), SCRATCHPAD_PANE (pane));
+
+  /* a pad switched to later on misses the registry coming up */
+  registry_changed_action (SCRATCHPAD_PANE (pane));
+
   return pane;
 }
 
+/*
+ * Settings tend to change several at a time, so they are read once from 
+ * an idle callback after the last of them.
+ */
 static void
 registry_changed_action (ScratchpadPane *pane)
 {
   ScratchpadPanePrivate *priv;
   
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->registry_id == 0)
+    priv->registry_id = g_idle_add ((GSourceFunc) apply_settings, pane);
+}
+
+/*
+ * Only what is different from the last time goes to the view. Changing 
+ * the font in particular has the whole buffer laid out again.
+ */
+static gboolean
+apply_settings (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  
   gdouble editor_tab_width;
   gboolean enable_automatic_indentation;
   gboolean insert_spaces_instead_of_tabs;
   gchar *fontname;
   PangoFontDescription *font_description;
+  gdouble memory_budget;
+  gdouble undo_depth;
   
   priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
   
+  priv->registry_id = 0;
+  
+  /* switching with snippets already shown would mix the orderings */
+  if (scratchpad_store_get_length (priv->store) == 0)
+    load_view_mode (pane);
+  
   editor_tab_width = codeslayer_registry_get_double (priv->registry,
                                                         CODESLAYER_REGISTRY_EDITOR_TAB_WIDTH);
-  gtk_source_view_set_tab_width (GTK_SOURCE_VIEW (priv->text_view), editor_tab_width);
-  gtk_source_view_set_indent_width (GTK_SOURCE_VIEW (priv->text_view), -1);
+  if (!priv->settings_applied || editor_tab_width != priv->editor_tab_width)
+    {
+      gtk_source_view_set_tab_width (GTK_SOURCE_VIEW (priv->text_view), editor_tab_width);
+      gtk_source_view_set_tab_width (GTK_SOURCE_VIEW (priv->diff_view), editor_tab_width);
+      gtk_source_view_set_indent_width (GTK_SOURCE_VIEW (priv->text_view), -1);
+      priv->editor_tab_width = editor_tab_width;
+    }
 
   enable_automatic_indentation = codeslayer_registry_get_boolean (priv->registry,
                                                                      CODESLAYER_REGISTRY_EDITOR_ENABLE_AUTOMATIC_INDENTATION);
-  gtk_source_view_set_auto_indent (GTK_SOURCE_VIEW (priv->text_view), 
-                                   enable_automatic_indentation);
-  gtk_source_view_set_indent_on_tab (GTK_SOURCE_VIEW (priv->text_view),
-                                     enable_automatic_indentation);
+  if (!priv->settings_applied || enable_automatic_indentation != priv->enable_automatic_indentation)
+    {
+      gtk_source_view_set_auto_indent (GTK_SOURCE_VIEW (priv->text_view), 
+                                       enable_automatic_indentation);
+      gtk_source_view_set_indent_on_tab (GTK_SOURCE_VIEW (priv->text_view),
+                                         enable_automatic_indentation);
+      priv->enable_automatic_indentation = enable_automatic_indentation;
+    }
 
   insert_spaces_instead_of_tabs = codeslayer_registry_get_boolean (priv->registry,
                                                                       CODESLAYER_REGISTRY_EDITOR_INSERT_SPACES_INSTEAD_OF_TABS);
-  gtk_source_view_set_insert_spaces_instead_of_tabs (GTK_SOURCE_VIEW (priv->text_view),
-                                                     insert_spaces_instead_of_tabs);
+  if (!priv->settings_applied || insert_spaces_instead_of_tabs != priv->insert_spaces_instead_of_tabs)
+    {
+      gtk_source_view_set_insert_spaces_instead_of_tabs (GTK_SOURCE_VIEW (priv->text_view),
+                                                         insert_spaces_instead_of_tabs);
+      priv->insert_spaces_instead_of_tabs = insert_spaces_instead_of_tabs;
+    }
 
   fontname = codeslayer_registry_get_string (priv->registry,
                                                 CODESLAYER_REGISTRY_EDITOR_FONT);
-  font_description = pango_font_description_from_string (fontname);
+  if (!priv->settings_applied || g_strcmp0 (fontname, priv->fontname) != 0)
+    {
+      font_description = pango_font_description_from_string (fontname);
+      gtk_widget_override_font (GTK_WIDGET (priv->text_view), font_description);
+      gtk_widget_override_font (GTK_WIDGET (priv->diff_view), font_description);
+      pango_font_description_free (font_description);  
+      
+      g_free (priv->fontname);
+      priv->fontname = fontname;
+    }
+  else if (fontname)
+    {
+      g_free (fontname);
+    }
+  
+  /* in megabytes, 0 for no limit */
+  memory_budget = codeslayer_registry_get_double (priv->registry, SCRATCHPAD_MEMORY_BUDGET);
+  if (!priv->settings_applied || memory_budget != priv->memory_budget)
+    {
+      scratchpad_store_set_budget (priv->store, MAX (memory_budget, 0) * 1024 * 1024);
+      priv->memory_budget = memory_budget;
+    }
+  
+  /* in undo steps, 0 for the default and less than that for none */
+  undo_depth = codeslayer_registry_get_double (priv->registry, SCRATCHPAD_UNDO_DEPTH);
+  if (!priv->settings_applied || undo_depth != priv->undo_depth)
+    {
+      scratchpad_undo_set_depth (priv->undo, undo_depth < 0 ? 0 : 
+                                 undo_depth > 0 ? (guint) undo_depth : SCRATCHPAD_UNDO_DEFAULT_DEPTH);
+      priv->undo_depth = undo_depth;
+    }
+  
+  priv->settings_applied = TRUE;
+  
+  return FALSE;
+}
+
+static void
+load_view_mode (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  gchar *insert_mode;
   
-  if (fontname)
-    g_free (fontname);
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+
+  insert_mode = codeslayer_registry_get_string (priv->registry,
+                                                SCRATCHPAD_INSERT_MODE);
+  priv->append = g_strcmp0 (insert_mode, SCRATCHPAD_INSERT_MODE_TOP) != 0;
   
-  gtk_widget_override_font (GTK_WIDGET (priv->text_view), font_description);
-  pango_font_description_free (font_description);  
+  if (insert_mode)
+    g_free (insert_mode);
+      
+  /* the buffer is regenerated from the store while scrolling so 
+     edits made in it would be lost, and with a memory budget there 
+     is no keeping every snippet in the buffer */
+  priv->virtual = codeslayer_registry_get_boolean (priv->registry,
+                                                   SCRATCHPAD_VIRTUAL_VIEW) ||
+                  codeslayer_registry_get_double (priv->registry,
+                                                  SCRATCHPAD_MEMORY_BUDGET) > 0;
+  gtk_text_view_set_editable (GTK_TEXT_VIEW (priv->text_view), !priv->virtual);
 }
 
 void
 scratchpad_pane_add_text (ScratchpadPane *pane, 
                           const gchar    *header,
                           const gchar    *text)
+{
+  gchar *file_path;
+  gint line_number;
+
+  if (!parse_header (header, &file_path, &line_number))
+    {
+      file_path = g_strdup (header);
+      line_number = 0;
+    }
+
+  scratchpad_pane_add_snippet (pane, file_path, line_number, g_strdup (text));
+  g_free (file_path);
+}                                       
+
+/*
+ * Record the snippet and show it. The pane takes over the text. When the 
+ * new snippet is not next to the ones that are in the buffer the virtual 
+ * view jumps to it. The snippet is only good until the next one is added.
+ */
+ScratchpadSnippet*
+scratchpad_pane_add_snippet (ScratchpadPane *pane, 
+                             const gchar    *file_path,
+                             gint            line_number,
+                             gchar          *text)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  guint index;
+  gint64 start_time;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  start_time = SCRATCHPAD_STATS_START ();
+
+  snippet = scratchpad_store_add (priv->store, file_path, line_number, text);
+  
+  /* the same text from the same place again, the store folded it in */
+  if (snippet->count > 1)
+    {
+      snippet = show_snippet (pane, snippet);
+      SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_ADD, start_time);
+      return snippet;
+    }
+  
+  scratchpad_undo_add_capture (priv->undo, snippet->id);
+  
+  scratchpad_search_add (priv->search, snippet);
+  scratchpad_palette_add (priv->palette, snippet);
+  
+  /* ids only grow so a new match goes on the end of the results */
+  if (priv->results != NULL && 
+      scratchpad_search_match_snippet (snippet, priv->query))
+    g_array_append_val (priv->results, snippet->id);
+  
+  index = scratchpad_store_get_length (priv->store) - 1;
+
+  /* while a restore is pending the window always runs to the end of the 
+     store, so a capture goes on the end of it rather than resetting it */
+  if (priv->window_end == index)
+    {
+      snippet = scratchpad_store_get (priv->store, index);
+      render_snippet (pane, snippet, priv->append);
+      priv->window_end++;
+      if (priv->virtual && priv->batch == 0)
+        trim_window (pane, priv->append);
+    }
+  else
+    {
+      reset_window (pane, index);
+      snippet = scratchpad_store_get (priv->store, index);
+    }
+  
+  if (priv->batch == 0)
+    gtk_text_view_scroll_mark_onscreen (GTK_TEXT_VIEW (priv->text_view), snippet->mark);
+
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_ADD, start_time);
+  
+  return snippet;
+}                                       
+
+/*
+ * Bring a snippet that is already in the pad into view.
+ */
+static ScratchpadSnippet*
+show_snippet (ScratchpadPane    *pane,
+              ScratchpadSnippet *snippet)
+{
+  ScratchpadPanePrivate *priv;
+  gint index;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  /* the restore gets to it soon, rendering the whole pad now would not */
+  if (snippet->mark == NULL && priv->restore_id != 0)
+    {
+      priv->restore_show = snippet->id;
+      return snippet;
+    }
+  
+  if (snippet->mark == NULL)
+    {
+      index = scratchpad_store_find_id (priv->store, snippet->id);
+      reset_window (pane, index);
+      snippet = scratchpad_store_get (priv->store, index);
+    }
+
+  if (priv->batch == 0)
+    gtk_text_view_scroll_mark_onscreen (GTK_TEXT_VIEW (priv->text_view), snippet->mark);
+  
+  return snippet;
+}
+
+/*
+ * Snippets added between the begin and the end of a batch go into the 
+ * buffer as one user action. The window is only trimmed and the view 
+ * only scrolled once the batch is over, and the scroll handler is kept 
+ * from growing the window while the buffer is changing underneath it.
+ */
+void
+scratchpad_pane_begin_batch (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->batch++ > 0)
+    return;
+  
+  priv->scrolling = TRUE;
+  gtk_text_buffer_begin_user_action (priv->buffer);
+}
+
+void
+scratchpad_pane_end_batch (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  guint length;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  g_return_if_fail (priv->batch > 0);
+  
+  if (--priv->batch > 0)
+    return;
+
+  if (priv->virtual)
+    trim_window (pane, priv->append);
+  
+  gtk_text_buffer_end_user_action (priv->buffer);
+  priv->scrolling = FALSE;
+  
+  length = scratchpad_store_get_length (priv->store);
+  if (length == 0)
+    return;
+
+  snippet = scratchpad_store_get (priv->store, length - 1);
+  if (snippet->mark != NULL)
+    gtk_text_view_scroll_mark_onscreen (GTK_TEXT_VIEW (priv->text_view), snippet->mark);
+}
+
+/*
+ * Remove the snippet and the part of the buffer that shows it. 
+ */
+void
+scratchpad_pane_remove_snippet (ScratchpadPane *pane,
+                                guint           index)
+{
+  ScratchpadPanePrivate *priv;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (take_out_snippet (pane, index))
+    scratchpad_store_remove (priv->store, index);
+}
+
+/*
+ * Take a capture back out for an undo. Its record is left in the journal 
+ * so that a redo can bring it back, and is returned. G_MAXUINT when there 
+ * is no such snippet or it has no record to bring it back from, and then
+ * the snippet stays where it is.
+ */
+guint
+scratchpad_pane_detach_snippet (ScratchpadPane *pane,
+                                guint           id)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  gint index;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  index = scratchpad_store_find_id (priv->store, id);
+  if (index < 0)
+    return G_MAXUINT;
+  
+  snippet = scratchpad_store_get (priv->store, index);
+  if (snippet == NULL || snippet->record == G_MAXUINT)
+    return G_MAXUINT;
+  
+  if (!take_out_snippet (pane, index))
+    return G_MAXUINT;
+  
+  return scratchpad_store_detach (priv->store, index);
+}
+
+/*
+ * Bring a capture back from its journal record for a redo. It comes back
+ * as the newest snippet under a new id.
+ */
+gboolean
+scratchpad_pane_attach_record (ScratchpadPane *pane,
+                               guint           record,
+                               guint          *id)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadJournal *journal;
+  ScratchpadSnippet *snippet;
+  ScratchpadSnippet saved;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  journal = scratchpad_store_get_journal (priv->store);
+  if (journal == NULL)
+    return FALSE;
+  
+  memset (&saved, 0, sizeof (ScratchpadSnippet));
+  saved.record = record;
+  if (!scratchpad_journal_read (journal, &saved))
+    return FALSE;
+  
+  snippet = scratchpad_pane_add_snippet (pane, saved.file_path, saved.line_number, 
+                                         g_strdup (saved.text));
+  snippet->timestamp = saved.timestamp;
+
+  /* the same text was captured again in the meantime */
+  if (snippet->record == G_MAXUINT)
+    snippet->record = record;
+  else if (snippet->record != record)
+    scratchpad_journal_remove (journal, record);
+  
+  *id = snippet->id;
+  return TRUE;
+}
+
+/*
+ * Get the snippet out of the buffer, if it is in there, and keep the 
+ * window in line with the store it is about to be taken out of.
+ */
+static gboolean
+take_out_snippet (ScratchpadPane *pane,
+                  guint           index)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  snippet = scratchpad_store_get (priv->store, index);
+  if (snippet == NULL)
+    return FALSE;
+  
+  scratchpad_palette_remove (priv->palette, snippet->id);
+  
+  if (snippet->mark != NULL)
+    {
+      unrender_snippet (pane, index);
+      priv->window_end--;
+    }
+  else if (index < priv->window_start)
+    {
+      priv->window_start--;
+      priv->window_end--;
+    }
+  
+  return TRUE;
+}
+
+/*
+ * Insert the snippet at the top or the bottom of the buffer. At the end 
+ * iter nothing already in the buffer moves. At the start iter the links 
+ * below it are moved once for the whole snippet rather than for every 
+ * piece of it. The mark has right gravity so that it is pushed down by 
+ * anything above it.
+ */
+static void
+render_snippet (ScratchpadPane    *pane,
+                ScratchpadSnippet *snippet,
+                gboolean           at_end)
 {
   ScratchpadPanePrivate *priv;
-  GtkTextBuffer *buffer;
   GtkTextIter iter;
-  gchar *format_text;
+  gchar line[SCRATCHPAD_STORE_LINE_SIZE];
+  gint start_offset;
+  gint length;
+  gint64 start_time;
 
   priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
 
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->text_view));
+  start_time = SCRATCHPAD_STATS_START ();
+  
+  /* the header goes in piece by piece rather than being formatted first */
+  scratchpad_store_format_line (snippet->line_number, line);
+  
+  if (at_end)
+    {
+      gtk_text_buffer_get_end_iter (priv->buffer, &iter);
+      start_offset = gtk_text_iter_get_offset (&iter);
+    }
+  else
+    {
+      gtk_text_buffer_get_start_iter (priv->buffer, &iter);
+      start_offset = 0;
+    }
+
+  gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+  priv->adding = TRUE;
+  gtk_text_buffer_insert_with_tags_by_name (priv->buffer, &iter, "\n", 1, "header", NULL);
+  gtk_text_buffer_insert_with_tags_by_name (priv->buffer, &iter, snippet->file_path, -1, "header", NULL);
+  gtk_text_buffer_insert_with_tags_by_name (priv->buffer, &iter, line, -1, "header", NULL);
+  gtk_text_buffer_insert_with_tags_by_name (priv->buffer, &iter, "\n\n", 2, "header", NULL);
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_HEADER, start_time);
+  
+  start_time = SCRATCHPAD_STATS_START ();
+  gtk_text_buffer_insert (priv->buffer, &iter, snippet->text, -1);
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_INSERT, start_time);
+  priv->adding = FALSE;
+  gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+  
+  length = gtk_text_iter_get_offset (&iter) - start_offset;
+
+  gtk_text_buffer_get_iter_at_offset (priv->buffer, &iter, start_offset);
+  snippet->mark = gtk_text_buffer_create_mark (priv->buffer, NULL, &iter, FALSE);
 
-  format_text = g_strconcat ("\n", header, "\n\n", NULL);
+  if (!at_end)
+    scratchpad_links_insert (priv->links, 0, length);
 
-  gtk_text_buffer_get_start_iter (buffer, &iter);
-  gtk_text_buffer_insert (buffer, &iter, text, -1);
+  start_time = SCRATCHPAD_STATS_START ();
+  
+  /* the header starts after the leading newline */
+  add_link (pane, snippet, start_offset + 1, 
+            g_utf8_strlen (snippet->file_path, -1) + strlen (line));
+  
+  SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_LINK, start_time);
   
-  gtk_text_buffer_get_start_iter (buffer, &iter);
-  gtk_text_buffer_insert_with_tags_by_name (buffer, &iter, format_text, -1, "header", NULL);
+  if (priv->query != NULL)
+    highlight_snippet (pane, snippet);
   
-  codeslayer_editor_linker_create_links (priv->linker);
+  /* syntax highlighting that was worked out before goes straight back on */
+  snippet->painted = FALSE;
+  if (snippet->highlights != NULL)
+    {
+      get_body_iter (pane, snippet, &iter);
+      scratchpad_highlighter_paint (priv->highlighter, snippet, &iter);
+    }
+  else
+    {
+      schedule_highlight (pane);
+    }
+}
 
-  g_free (format_text);
-}                                       
+/*
+ * Take the snippet out of the buffer. It runs down to the mark of its 
+ * neighbour below, which is the next snippet in append mode and the 
+ * previous one when the newest is shown on top. The links go with it
+ * through the delete-range handler.
+ */
+static void
+unrender_snippet (ScratchpadPane *pane,
+                  guint           index)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  ScratchpadSnippet *below = NULL;
+  GtkTextIter start, end;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+
+  snippet = scratchpad_store_get (priv->store, index);
+
+  if (priv->append && index + 1 < priv->window_end)
+    below = scratchpad_store_get (priv->store, index + 1);
+  else if (!priv->append && index > priv->window_start)
+    below = scratchpad_store_get (priv->store, index - 1);
+  
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, &start, snippet->mark);
+
+  if (below != NULL)
+    gtk_text_buffer_get_iter_at_mark (priv->buffer, &end, below->mark);
+  else
+    gtk_text_buffer_get_end_iter (priv->buffer, &end);
+
+  gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+  gtk_text_buffer_delete (priv->buffer, &start, &end);
+  gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+  gtk_text_buffer_delete_mark (priv->buffer, snippet->mark);
+  snippet->mark = NULL;
+}
+
+/*
+ * Drop snippets off the top or the bottom of the buffer until the window 
+ * is back within its size.
+ */
+static void
+trim_window (ScratchpadPane *pane,
+             gboolean        from_top)
+{
+  ScratchpadPanePrivate *priv;
+  
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+
+  while (priv->window_end - priv->window_start > WINDOW_SIZE)
+    {
+      /* in append mode the older snippets are the ones on top */
+      if (from_top == priv->append)
+        {
+          unrender_snippet (pane, priv->window_start);
+          priv->window_start++;
+        }
+      else
+        {
+          unrender_snippet (pane, priv->window_end - 1);
+          priv->window_end--;
+        }
+    }
+}
+
+/*
+ * Materialize more snippets above or below the ones already in the buffer,
+ * keeping the text that is currently at the top of the view in place.
+ */
+static void
+grow_window (ScratchpadPane *pane,
+             gboolean        upward)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextView *text_view;
+  GdkRectangle rect;
+  GtkTextIter iter;
+  GtkTextMark *anchor;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  text_view = GTK_TEXT_VIEW (priv->text_view);
+  
+  gtk_text_view_get_visible_rect (text_view, &rect);
+  gtk_text_view_get_iter_at_location (text_view, &iter, rect.x, rect.y);
+  anchor = gtk_text_buffer_create_mark (priv->buffer, NULL, &iter, TRUE);
+
+  if (extend_window (pane, upward) > 0)
+    {
+      trim_window (pane, !upward);
+      gtk_text_view_scroll_to_mark (text_view, anchor, 0.0, TRUE, 0.0, 0.0);
+    }
+
+  gtk_text_buffer_delete_mark (priv->buffer, anchor);
+}
+
+/*
+ * Render up to a step of snippets next to the window and return how many.
+ */
+static guint
+extend_window (ScratchpadPane *pane,
+               gboolean        upward)
+{
+  ScratchpadPanePrivate *priv;
+  guint length;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  length = scratchpad_store_get_length (priv->store);
+
+  for (i = 0; i < WINDOW_STEP; i++)
+    {
+      /* in append mode the older snippets are the ones on top */
+      if (upward == priv->append)
+        {
+          if (priv->window_start == 0)
+            break;
+          priv->window_start--;
+          render_snippet (pane, scratchpad_store_get (priv->store, priv->window_start), !upward);
+        }
+      else
+        {
+          if (priv->window_end == length)
+            break;
+          render_snippet (pane, scratchpad_store_get (priv->store, priv->window_end), !upward);
+          priv->window_end++;
+        }
+    }
+  
+  return i;
+}
+
+/*
+ * Throw away what is in the buffer and materialize the snippets around 
+ * the one at the index.
+ */
+static void
+reset_window (ScratchpadPane *pane,
+              guint           index)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter start, end;
+  guint length;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->restore_id != 0)
+    {
+      g_source_remove (priv->restore_id);
+      priv->restore_id = 0;
+      priv->restore_show = G_MAXUINT;
+    }
+  
+  length = scratchpad_store_get_length (priv->store);
+  
+  for (i = priv->window_start; i < priv->window_end; i++)
+    {
+      ScratchpadSnippet *snippet = scratchpad_store_get (priv->store, i);
+      gtk_text_buffer_delete_mark (priv->buffer, snippet->mark);
+      snippet->mark = NULL;
+    }
+
+  gtk_text_buffer_get_bounds (priv->buffer, &start, &end);
+  gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+  gtk_text_buffer_delete (priv->buffer, &start, &end);
+  gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+
+  if (priv->virtual)
+    {
+      priv->window_start = index > WINDOW_SIZE / 2 ? index - WINDOW_SIZE / 2 : 0;
+      priv->window_end = MIN (priv->window_start + WINDOW_SIZE, length);
+    }
+  else
+    {
+      priv->window_start = 0;
+      priv->window_end = length;
+    }
+  
+  for (i = priv->window_start; i < priv->window_end; i++)
+    render_snippet (pane, scratchpad_store_get (priv->store, i), priv->append);
+}
+
+static void
+scroll_action (ScratchpadPane *pane,
+               GtkAdjustment  *adjustment)
+{
+  ScratchpadPanePrivate *priv;
+  gdouble value, page_size, upper;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  schedule_highlight (pane);
+  
+  if (!priv->virtual || priv->scrolling)
+    return;
+
+  value = gtk_adjustment_get_value (adjustment);
+  page_size = gtk_adjustment_get_page_size (adjustment);
+  upper = gtk_adjustment_get_upper (adjustment);
+  
+  priv->scrolling = TRUE;
+
+  if (value < page_size)
+    grow_window (pane, TRUE);
+  else if (value + 2 * page_size > upper)
+    grow_window (pane, FALSE);
+
+  priv->scrolling = FALSE;
+}
+
+static void
+schedule_highlight (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->highlight_id == 0)
+    priv->highlight_id = g_idle_add_full (G_PRIORITY_LOW, (GSourceFunc) highlight_action, 
+                                          pane, NULL);
+}
+
+/*
+ * Syntax highlight the snippets that are on screen or within a page of 
+ * it, a few at a time. Everything else waits until it is scrolled to.
+ */
+static gboolean
+highlight_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextView *text_view;
+  GdkRectangle rect;
+  GtkTextIter iter;
+  guint first, last;
+  guint painted = 0;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->window_start == priv->window_end)
+    {
+      priv->highlight_id = 0;
+      return FALSE;
+    }
+  
+  text_view = GTK_TEXT_VIEW (priv->text_view);
+  gtk_text_view_get_visible_rect (text_view, &rect);
+  
+  gtk_text_view_get_iter_at_location (text_view, &iter, rect.x, MAX (rect.y - rect.height, 0));
+  first = find_snippet_at (pane, gtk_text_iter_get_offset (&iter));
+  gtk_text_view_get_iter_at_location (text_view, &iter, rect.x, rect.y + 2 * rect.height);
+  last = find_snippet_at (pane, gtk_text_iter_get_offset (&iter));
+  
+  /* the newest snippet is on top */
+  if (first > last)
+    {
+      guint swap = first;
+      first = last;
+      last = swap;
+    }
+  
+  for (i = first; i <= last && painted < HIGHLIGHT_STEP; i++)
+    {
+      ScratchpadSnippet *snippet = scratchpad_store_get (priv->store, i);
+      if (snippet->painted)
+        continue;
+
+      get_body_iter (pane, snippet, &iter);
+      scratchpad_highlighter_paint (priv->highlighter, snippet, &iter);
+      painted++;
+    }
+  
+  if (painted == HIGHLIGHT_STEP)
+    return TRUE;
+  
+  priv->highlight_id = 0;
+  return FALSE;
+}
+
+/*
+ * The index of the snippet that the offset is in. The snippets in the
+ * buffer are in index order in append mode and the other way around 
+ * when the newest is on top.
+ */
+static guint
+find_snippet_at (ScratchpadPane *pane,
+                 gint            offset)
+{
+  ScratchpadPanePrivate *priv;
+  gint low, high;
+  guint result;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  low = priv->window_start;
+  high = priv->window_end - 1;
+  result = priv->append ? priv->window_start : priv->window_end - 1;
+  
+  while (low <= high)
+    {
+      ScratchpadSnippet *snippet;
+      GtkTextIter iter;
+      gint middle;
+      
+      middle = (low + high) / 2;
+      snippet = scratchpad_store_get (priv->store, middle);
+      gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, snippet->mark);
+      
+      if (gtk_text_iter_get_offset (&iter) <= offset)
+        {
+          result = middle;
+          if (priv->append)
+            low = middle + 1;
+          else
+            high = middle - 1;
+        }
+      else
+        {
+          if (priv->append)
+            high = middle - 1;
+          else
+            low = middle + 1;
+        }
+    }
+  
+  return result;
+}
+
+static void
+populate_popup_action (ScratchpadPane *pane,
+                       GtkWidget      *popup)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  GtkWidget *separator;
+  GtkWidget *item;
+  
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (!GTK_IS_MENU (popup))
+    return;
+
+  separator = gtk_separator_menu_item_new ();
+  gtk_menu_shell_append (GTK_MENU_SHELL (popup), separator);
+  gtk_widget_show (separator);
+  
+  /* the diffs are of the snippet that has the cursor */
+  snippet = get_cursor_snippet (pane);
+  if (snippet != NULL)
+    {
+      if (snippet->line_number > 0)
+        {
+          item = gtk_menu_item_new_with_label ("Diff With Source");
+          gtk_menu_shell_append (GTK_MENU_SHELL (popup), item);
+          gtk_widget_show (item);
+          g_signal_connect_swapped (G_OBJECT (item), "activate",
+                                    G_CALLBACK (diff_source_action), pane);
+        }
+      
+      item = gtk_menu_item_new_with_label ("Mark For Diff");
+      gtk_menu_shell_append (GTK_MENU_SHELL (popup), item);
+      gtk_widget_show (item);
+      g_signal_connect_swapped (G_OBJECT (item), "activate",
+                                G_CALLBACK (mark_diff_action), pane);
+      
+      if (priv->diff_base != G_MAXUINT && priv->diff_base != snippet->id &&
+          scratchpad_store_find_id (priv->store, priv->diff_base) >= 0)
+        {
+          item = gtk_menu_item_new_with_label ("Diff With Marked");
+          gtk_menu_shell_append (GTK_MENU_SHELL (popup), item);
+          gtk_widget_show (item);
+          g_signal_connect_swapped (G_OBJECT (item), "activate",
+                                    G_CALLBACK (diff_marked_action), pane);
+        }
+    }
+  
+  item = gtk_menu_item_new_with_label ("Export...");
+  gtk_menu_shell_append (GTK_MENU_SHELL (popup), item);
+  gtk_widget_show (item);
+  
+  g_signal_connect_swapped (G_OBJECT (item), "activate",
+                            G_CALLBACK (export_action), pane);
+  
+  if (scratchpad_stats_enabled)
+    {
+      item = gtk_menu_item_new_with_label ("Statistics...");
+      gtk_menu_shell_append (GTK_MENU_SHELL (popup), item);
+      gtk_widget_show (item);
+      g_signal_connect_swapped (G_OBJECT (item), "activate",
+                                G_CALLBACK (stats_action), pane);
+    }
+}
+
+static void
+stats_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkWidget *toplevel;
+  GtkWidget *dialog;
+  gchar *report;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (pane));
+  report = scratchpad_stats_report (priv->store);
+
+  dialog = gtk_message_dialog_new (gtk_widget_is_toplevel (toplevel) ? GTK_WINDOW (toplevel) : NULL, 
+                                   GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE,
+                                   "ScratchPad Statistics");
+  gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog), "%s", report);
+  gtk_dialog_run (GTK_DIALOG (dialog));
+  gtk_widget_destroy (dialog);
+  
+  g_free (report);
+}
+
+/*
+ * The format goes by the extension that is given to the file.
+ */
+static void
+export_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkWidget *dialog;
+  GtkWidget *toplevel;
+  GError *error = NULL;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  toplevel = gtk_widget_get_toplevel (GTK_WIDGET (pane));
+
+  dialog = gtk_file_chooser_dialog_new ("Export ScratchPad", 
+                                        gtk_widget_is_toplevel (toplevel) ? GTK_WINDOW (toplevel) : NULL,
+                                        GTK_FILE_CHOOSER_ACTION_SAVE,
+                                        GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                        GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT,
+                                        NULL);
+  gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (dialog), TRUE);
+  gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (dialog), "scratchpad.md");
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT)
+    {
+      gchar *file_name;
+      
+      file_name = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+
+      if (!scratchpad_export (priv->store, file_name, 
+                              scratchpad_export_get_format (file_name), &error))
+        {
+          GtkWidget *message;
+          message = gtk_message_dialog_new (GTK_WINDOW (dialog), GTK_DIALOG_MODAL, 
+                                            GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+                                            "%s", error->message);
+          gtk_dialog_run (GTK_DIALOG (message));
+          gtk_widget_destroy (message);
+          g_error_free (error);
+        }
+
+      g_free (file_name);
+    }
+
+  gtk_widget_destroy (dialog);
+}
+
+static void
+search_changed_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  const gchar *query;
+  gint64 start_time;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  g_free (priv->query);
+  priv->query = NULL;
+
+  if (priv->results != NULL)
+    {
+      g_array_unref (priv->results);
+      priv->results = NULL;
+    }
+  
+  query = gtk_entry_get_text (GTK_ENTRY (priv->search_entry));
+  
+  if (query[0] != '\0')
+    {
+      start_time = SCRATCHPAD_STATS_START ();
+      priv->query = g_strdup (query);
+      priv->results = scratchpad_search_find (priv->search, query);
+      priv->result = 0;
+      
+      /* the search may have had evicted snippets brought back */
+      scratchpad_store_trim (priv->store);
+      SCRATCHPAD_STATS_STOP (SCRATCHPAD_STAT_SEARCH, start_time);
+    }
+
+  highlight_results (pane);
+}
+
+/*
+ * Go to the next snippet with a match, bringing it into the buffer first 
+ * if the virtual view does not have it.
+ */
+static void
+search_next_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  const gchar *match;
+  GtkTextIter iter;
+  gint index;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->results == NULL || priv->results->len == 0)
+    return;
+  
+  if (priv->result >= priv->results->len)
+    priv->result = 0;
+
+  index = scratchpad_store_find_id (priv->store, 
+                                    g_array_index (priv->results, guint, priv->result++));
+  if (index < 0)
+    return;
+  
+  snippet = scratchpad_store_get (priv->store, index);
+  if (snippet->mark == NULL)
+    {
+      reset_window (pane, index);
+      highlight_results (pane);
+    }
+  
+  get_body_iter (pane, snippet, &iter);
+  match = scratchpad_search_match (snippet->text, priv->query);
+  if (match != NULL)
+    gtk_text_iter_forward_chars (&iter, g_utf8_pointer_to_offset (snippet->text, match));
+  else
+    gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, snippet->mark);
+
+  gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (priv->text_view), &iter, 0.1, FALSE, 0.0, 0.0);
+}
+
+static void
+highlight_results (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter start, end;
+  guint count = 0;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  gtk_text_buffer_get_bounds (priv->buffer, &start, &end);
+  gtk_text_buffer_remove_tag_by_name (priv->buffer, "search", &start, &end);
+  
+  if (priv->results == NULL)
+    return;
+
+  for (i = 0; i < priv->results->len && count < MAX_HIGHLIGHTS; i++)
+    {
+      ScratchpadSnippet *snippet;
+      gint index;
+      
+      index = scratchpad_store_find_id (priv->store, g_array_index (priv->results, guint, i));
+      if (index < 0)
+        continue;
+
+      snippet = scratchpad_store_get (priv->store, index);
+      if (snippet->mark == NULL)
+        continue;
+
+      highlight_snippet (pane, snippet);
+      count++;
+    }
+}
+
+static void
+highlight_snippet (ScratchpadPane    *pane,
+                   ScratchpadSnippet *snippet)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter start, end;
+  const gchar *match;
+  const gchar *previous;
+  glong query_length;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  query_length = g_utf8_strlen (priv->query, -1);
+
+  get_body_iter (pane, snippet, &start);
+  
+  previous = snippet->text;
+  match = scratchpad_search_match (previous, priv->query);
+
+  while (match != NULL)
+    {
+      gtk_text_iter_forward_chars (&start, g_utf8_pointer_to_offset (previous, match));
+      end = start;
+      gtk_text_iter_forward_chars (&end, query_length);
+      gtk_text_buffer_apply_tag_by_name (priv->buffer, "search", &start, &end);
+
+      previous = match;
+      match = scratchpad_search_match (g_utf8_next_char (match), priv->query);
+    }
+}
+
+/*
+ * The jump palette sits under the search entry and stays hidden until 
+ * it is asked for. The list is only ever a screenful of the best matches.
+ */
+static void
+create_palette (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkWidget *scrolled_window;
+  GtkCellRenderer *renderer;
+  GtkTreeViewColumn *column;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  priv->palette_box = gtk_vbox_new (FALSE, 0);
+  gtk_widget_set_no_show_all (priv->palette_box, TRUE);
+
+  priv->palette_entry = gtk_entry_new ();
+  gtk_entry_set_placeholder_text (GTK_ENTRY (priv->palette_entry), "Jump To Snippet");
+  g_signal_connect_swapped (G_OBJECT (priv->palette_entry), "changed",
+                            G_CALLBACK (palette_changed_action), pane);
+  g_signal_connect_swapped (G_OBJECT (priv->palette_entry), "key-press-event",
+                            G_CALLBACK (palette_key_action), pane);
+  gtk_box_pack_start (GTK_BOX (priv->palette_box), priv->palette_entry, FALSE, FALSE, 0);
+  gtk_widget_show (priv->palette_entry);
+  
+  priv->palette_list = gtk_list_store_new (PALETTE_COLUMNS, G_TYPE_STRING, G_TYPE_UINT);
+  priv->palette_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->palette_list));
+  g_object_unref (priv->palette_list);
+  gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (priv->palette_view), FALSE);
+  g_signal_connect_swapped (G_OBJECT (priv->palette_view), "row-activated",
+                            G_CALLBACK (palette_activated_action), pane);
+  
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (G_OBJECT (renderer), "ellipsize", PANGO_ELLIPSIZE_MIDDLE, NULL);
+  column = gtk_tree_view_column_new_with_attributes (NULL, renderer, 
+                                                     "text", PALETTE_LABEL, NULL);
+  gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (priv->palette_view), column);
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (priv->palette_view), TRUE);
+  gtk_widget_show (priv->palette_view);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (scrolled_window), 160);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->palette_view);
+  gtk_box_pack_start (GTK_BOX (priv->palette_box), scrolled_window, FALSE, FALSE, 0);
+  gtk_widget_show (scrolled_window);
+  
+  gtk_box_pack_start (GTK_BOX (pane), priv->palette_box, FALSE, FALSE, 0);
+}
+
+/*
+ * Control-J anywhere in the pane brings up the palette, and escape takes 
+ * down the diff view.
+ */
+static gboolean
+key_press_action (ScratchpadPane *pane,
+                  GdkEventKey    *event)
+{
+  ScratchpadPanePrivate *priv;
+  
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if ((event->state & GDK_CONTROL_MASK) && 
+      (event->keyval == GDK_KEY_j || event->keyval == GDK_KEY_J))
+    {
+      open_palette (pane);
+      return TRUE;
+    }
+  
+  if (event->keyval == GDK_KEY_Escape && gtk_widget_get_visible (priv->diff_box))
+    {
+      close_diff (pane);
+      return TRUE;
+    }
+  
+  return FALSE;
+}
+
+static void
+open_palette (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  gtk_widget_show (priv->palette_box);
+  gtk_widget_grab_focus (priv->palette_entry);
+  gtk_editable_select_region (GTK_EDITABLE (priv->palette_entry), 0, -1);
+  
+  palette_changed_action (pane);
+}
+
+static void
+close_palette (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  gtk_widget_hide (priv->palette_box);
+  gtk_list_store_clear (priv->palette_list);
+  gtk_widget_grab_focus (priv->text_view);
+}
+
+static void
+palette_changed_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTreeIter iter;
+  GArray *ids;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  ids = scratchpad_palette_rank (priv->palette, 
+                                 gtk_entry_get_text (GTK_ENTRY (priv->palette_entry)), 
+                                 PALETTE_ROWS);
+
+  /* the first ranking may have had evicted snippets brought back */
+  scratchpad_store_trim (priv->store);
+  
+  gtk_list_store_clear (priv->palette_list);
+  
+  for (i = 0; i < ids->len; i++)
+    {
+      guint id = g_array_index (ids, guint, i);
+      gtk_list_store_insert_with_values (priv->palette_list, NULL, -1, 
+                                         PALETTE_LABEL, scratchpad_palette_get_label (priv->palette, id),
+                                         PALETTE_ID, id, 
+                                         -1);
+    }
+  
+  g_array_unref (ids);
+  
+  if (gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->palette_list), &iter))
+    gtk_tree_selection_select_iter (gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->palette_view)), 
+                                    &iter);
+}
+
+/*
+ * The focus stays in the entry, so the keys for the list are taken here.
+ */
+static gboolean
+palette_key_action (ScratchpadPane *pane,
+                    GdkEventKey    *event)
+{
+  switch (event->keyval)
+    {
+    case GDK_KEY_Escape:
+      close_palette (pane);
+      return TRUE;
+    case GDK_KEY_Up:
+      move_palette_selection (pane, -1);
+      return TRUE;
+    case GDK_KEY_Down:
+      move_palette_selection (pane, 1);
+      return TRUE;
+    case GDK_KEY_Return:
+    case GDK_KEY_KP_Enter:
+      palette_activated_action (pane);
+      return TRUE;
+    }
+  
+  return FALSE;
+}
+
+static void
+move_palette_selection (ScratchpadPane *pane,
+                        gint            step)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTreeSelection *selection;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  GtkTreePath *path;
+  gint rows;
+  gint row = 0;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->palette_view));
+  model = GTK_TREE_MODEL (priv->palette_list);
+  
+  rows = gtk_tree_model_iter_n_children (model, NULL);
+  if (rows == 0)
+    return;
+  
+  if (gtk_tree_selection_get_selected (selection, NULL, &iter))
+    {
+      path = gtk_tree_model_get_path (model, &iter);
+      row = gtk_tree_path_get_indices (path)[0] + step;
+      gtk_tree_path_free (path);
+    }
+  
+  path = gtk_tree_path_new_from_indices (CLAMP (row, 0, rows - 1), -1);
+  gtk_tree_selection_select_path (selection, path);
+  gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (priv->palette_view), path, NULL, FALSE, 0.0, 0.0);
+  gtk_tree_path_free (path);
+}
+
+static void
+palette_activated_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTreeSelection *selection;
+  GtkTreeIter iter;
+  guint id;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->palette_view));
+  if (!gtk_tree_selection_get_selected (selection, NULL, &iter))
+    return;
+  
+  gtk_tree_model_get (GTK_TREE_MODEL (priv->palette_list), &iter, PALETTE_ID, &id, -1);
+  
+  close_palette (pane);
+  jump_to_snippet (pane, id);
+}
+
+/*
+ * Put the snippet at the top of the view, bringing it into the buffer 
+ * first if the virtual view does not have it.
+ */
+static void
+jump_to_snippet (ScratchpadPane *pane,
+                 guint           id)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  GtkTextIter iter;
+  gint index;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  index = scratchpad_store_find_id (priv->store, id);
+  if (index < 0)
+    return;
+  
+  snippet = scratchpad_store_get (priv->store, index);
+  if (snippet->mark == NULL)
+    {
+      reset_window (pane, index);
+      highlight_results (pane);
+    }
+  
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, snippet->mark);
+  gtk_text_buffer_place_cursor (priv->buffer, &iter);
+  gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (priv->text_view), snippet->mark, 
+                                0.0, TRUE, 0.0, 0.0);
+}
+
+/*
+ * The diff view takes the place of the pad while it is up. The lines are
+ * tagged the way the headers are in the pad.
+ */
+static void
+create_diff_view (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextBuffer *buffer;
+  GtkWidget *scrolled_window;
+  GtkWidget *hbox;
+  GtkWidget *button;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  priv->diff_box = gtk_vbox_new (FALSE, 0);
+  gtk_widget_set_no_show_all (priv->diff_box, TRUE);
+  
+  hbox = gtk_hbox_new (FALSE, 0);
+  priv->diff_label = gtk_label_new (NULL);
+  gtk_label_set_ellipsize (GTK_LABEL (priv->diff_label), PANGO_ELLIPSIZE_MIDDLE);
+  gtk_misc_set_alignment (GTK_MISC (priv->diff_label), 0.0, 0.5);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->diff_label, TRUE, TRUE, 0);
+  
+  button = gtk_button_new_with_label ("Close");
+  gtk_button_set_relief (GTK_BUTTON (button), GTK_RELIEF_NONE);
+  g_signal_connect_swapped (G_OBJECT (button), "clicked",
+                            G_CALLBACK (close_diff), pane);
+  gtk_box_pack_start (GTK_BOX (hbox), button, FALSE, FALSE, 0);
+  
+  gtk_box_pack_start (GTK_BOX (priv->diff_box), hbox, FALSE, FALSE, 0);
+  gtk_widget_show_all (hbox);
+
+  priv->diff_view = gtk_source_view_new ();
+  gtk_text_view_set_editable (GTK_TEXT_VIEW (priv->diff_view), FALSE);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->diff_view));
+  gtk_text_buffer_create_tag (buffer, "added", "background", "#d6f5d6", NULL);
+  gtk_text_buffer_create_tag (buffer, "removed", "background", "#f5d6d6", NULL);
+  gtk_widget_show (priv->diff_view);
+  
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->diff_view);
+  gtk_box_pack_start (GTK_BOX (priv->diff_box), scrolled_window, TRUE, TRUE, 0);
+  gtk_widget_show (scrolled_window);
+  
+  gtk_box_pack_start (GTK_BOX (pane), priv->diff_box, TRUE, TRUE, 0);
+}
+
+static ScratchpadSnippet*
+get_cursor_snippet (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter iter;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->window_start == priv->window_end)
+    return NULL;
+  
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, 
+                                    gtk_text_buffer_get_insert (priv->buffer));
+
+  return scratchpad_store_get (priv->store, 
+                               find_snippet_at (pane, gtk_text_iter_get_offset (&iter)));
+}
+
+/*
+ * Compare the snippet with the lines it was taken from as they are now. 
+ * An editor that has the file open may have changes that are not saved.
+ */
+static void
+diff_source_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  CodeSlayerEditor *editor;
+  CodeSlayerDocument *document;
+  gchar *contents = NULL;
+  gchar *header;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  snippet = get_cursor_snippet (pane);
+  if (snippet == NULL)
+    return;
+  
+  editor = codeslayer_get_active_editor (priv->codeslayer);
+  document = codeslayer_get_active_editor_document (priv->codeslayer);
+  if (editor != NULL && document != NULL &&
+      g_strcmp0 (codeslayer_document_get_file_path (document), snippet->file_path) == 0)
+    {
+      GtkTextBuffer *buffer;
+      GtkTextIter start, end;
+      
+      buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (editor));
+      gtk_text_buffer_get_bounds (buffer, &start, &end);
+      contents = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+    }
+  
+  scratchpad_diff_source (priv->diff, snippet->text, snippet->file_path, 
+                          contents, snippet->line_number);
+  
+  header = scratchpad_store_get_header (snippet);
+  open_diff (pane, g_strdup_printf ("%s against the source", header));
+  
+  g_free (header);
+  g_free (contents);
+}
+
+static void
+mark_diff_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  snippet = get_cursor_snippet (pane);
+  if (snippet != NULL)
+    priv->diff_base = snippet->id;
+}
+
+/*
+ * The marked snippet is the old side, the one with the cursor the new.
+ */
+static void
+diff_marked_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  ScratchpadSnippet *base;
+  gchar *old_text;
+  gchar *old_header;
+  gchar *header;
+  gint index;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  index = scratchpad_store_find_id (priv->store, priv->diff_base);
+  if (index < 0)
+    return;
+  
+  /* getting the one snippet can evict the text of the other */
+  base = scratchpad_store_get (priv->store, index);
+  old_text = g_strdup (base->text);
+  old_header = scratchpad_store_get_header (base);
+  
+  snippet = get_cursor_snippet (pane);
+  if (snippet != NULL)
+    {
+      scratchpad_diff_texts (priv->diff, old_text, snippet->text);
+      header = scratchpad_store_get_header (snippet);
+      open_diff (pane, g_strdup_printf ("%s against %s", old_header, header));
+      g_free (header);
+    }
+  
+  g_free (old_text);
+  g_free (old_header);
+}
+
+/*
+ * Swap the pad for the diff view until the diff comes back. The view 
+ * takes the title.
+ */
+static void
+open_diff (ScratchpadPane *pane,
+           gchar          *title)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextBuffer *buffer;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  g_free (priv->diff_title);
+  priv->diff_title = title;
+  
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->diff_view));
+  gtk_text_buffer_set_text (buffer, "", -1);
+  gtk_label_set_text (GTK_LABEL (priv->diff_label), title);
+  
+  gtk_widget_hide (priv->pad_window);
+  gtk_widget_show (priv->diff_box);
+  gtk_widget_grab_focus (priv->diff_view);
+}
+
+static void
+close_diff (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  scratchpad_diff_cancel (priv->diff);
+  
+  gtk_text_buffer_set_text (gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->diff_view)), "", -1);
+  gtk_widget_hide (priv->diff_box);
+  gtk_widget_show (priv->pad_window);
+  gtk_widget_grab_focus (priv->text_view);
+}
+
+static void
+diff_finished_action (ScratchpadPane       *pane,
+                      ScratchpadDiffResult *result)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  gboolean first = TRUE;
+  gchar *summary;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (result->error != NULL)
+    {
+      summary = g_strdup_printf ("%s: %s", priv->diff_title, result->error->message);
+      gtk_label_set_text (GTK_LABEL (priv->diff_label), summary);
+      g_free (summary);
+      return;
+    }
+  
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->diff_view));
+  gtk_text_buffer_set_text (buffer, result->text->str, result->text->len);
+  
+  for (i = 0; i < result->runs->len; i++)
+    {
+      ScratchpadDiffRun *run = &g_array_index (result->runs, ScratchpadDiffRun, i);
+      
+      if (run->kind == SCRATCHPAD_DIFF_SAME)
+        continue;
+      
+      gtk_text_buffer_get_iter_at_line (buffer, &start, run->line);
+      gtk_text_buffer_get_iter_at_line (buffer, &end, run->line + run->count);
+      gtk_text_buffer_apply_tag_by_name (buffer, run->kind == SCRATCHPAD_DIFF_ADDED ? "added" : "removed", 
+                                         &start, &end);
+      
+      if (first)
+        {
+          gtk_text_buffer_place_cursor (buffer, &start);
+          gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (priv->diff_view), 
+                                        gtk_text_buffer_get_insert (buffer), 
+                                        0.1, FALSE, 0.0, 0.0);
+          first = FALSE;
+        }
+    }
+  
+  summary = g_strdup_printf ("%s, %u removed, %u added", priv->diff_title, 
+                             result->removed, result->added);
+  gtk_label_set_text (GTK_LABEL (priv->diff_label), summary);
+  g_free (summary);
+}
+
+/*
+ * The body comes after the newline, the header and the blank line that 
+ * render_snippet puts in front of it.
+ */
+static void
+get_body_iter (ScratchpadPane    *pane,
+               ScratchpadSnippet *snippet,
+               GtkTextIter       *iter)
+{
+  ScratchpadPanePrivate *priv;
+  gchar line[SCRATCHPAD_STORE_LINE_SIZE];
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  scratchpad_store_format_line (snippet->line_number, line);
+  
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, iter, snippet->mark);
+  gtk_text_iter_forward_chars (iter, 1 + g_utf8_strlen (snippet->file_path, -1) + strlen (line) + 2);
+}
+
+/*
+ * Bring back the snippets from an earlier session. The records are only 
+ * read as they are rendered. The virtual view renders the newest window 
+ * right away, otherwise the pad is filled in from an idle callback so
+ * that a long history does not hold up startup.
+ */
+void
+scratchpad_pane_restore (ScratchpadPane    *pane,
+                         ScratchpadJournal *journal)
+{
+  ScratchpadPanePrivate *priv;
+  guint length;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  load_view_mode (pane);
+  scratchpad_store_set_journal (priv->store, journal);
+  
+  length = scratchpad_store_get_length (priv->store);
+  if (length == 0)
+    return;
+  
+  if (priv->virtual)
+    {
+      reset_window (pane, length - 1);
+      return;
+    }
+
+  priv->window_start = length;
+  priv->window_end = length;
+  priv->restore_id = g_idle_add_full (G_PRIORITY_LOW, (GSourceFunc) restore_action, 
+                                      pane, NULL);
+}
+
+/*
+ * A repeat captured while this is going on is brought into view once it
+ * has been rendered.
+ */
+static gboolean
+restore_action (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  guint rendered;
+  gint index;
+  
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  /* the older snippets are on top in append mode */
+  rendered = extend_window (pane, priv->append);
+  
+  if (priv->restore_show != G_MAXUINT)
+    {
+      index = scratchpad_store_find_id (priv->store, priv->restore_show);
+      if (index < 0)
+        {
+          priv->restore_show = G_MAXUINT;
+        }
+      else if ((guint) index >= priv->window_start)
+        {
+          gtk_text_view_scroll_mark_onscreen (GTK_TEXT_VIEW (priv->text_view), 
+                                              scratchpad_store_get (priv->store, index)->mark);
+          priv->restore_show = G_MAXUINT;
+        }
+    }
+  
+  if (rendered > 0)
+    return TRUE;
+  
+  priv->restore_id = 0;
+  priv->restore_show = G_MAXUINT;
+  return FALSE;
+}
+
+ScratchpadStore*
+scratchpad_pane_get_store (ScratchpadPane *pane)
+{
+  ScratchpadPanePrivate *priv;
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  return priv->store;
+}
+
+static gboolean
+parse_header (const gchar  *header,
+              gchar       **file_path,
+              gint         *line_number)
+{
+  const gchar *separator;
+  
+  separator = strrchr (header, ':');
+  if (separator == NULL || separator == header)
+    return FALSE;
+  
+  *line_number = atoi (separator + 1);
+  if (*line_number <= 0)
+    return FALSE;
+  
+  *file_path = g_strndup (header, separator - header);
+  return TRUE;
+}
+
+/*
+ * Underline the header and remember where it leads. Snippets that were 
+ * not taken from a line of a file have nowhere to go.
+ */
+static void
+add_link (ScratchpadPane    *pane,
+          ScratchpadSnippet *snippet,
+          gint               start_offset,
+          gint               length)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter start, end;
+  
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (snippet->line_number <= 0)
+    return;
+  
+  scratchpad_links_add (priv->links, start_offset, length, snippet->file_path, 
+                        snippet->line_number, snippet->id);
+  
+  gtk_text_buffer_get_iter_at_offset (priv->buffer, &start, start_offset);
+  gtk_text_buffer_get_iter_at_offset (priv->buffer, &end, start_offset + length);
+  gtk_text_buffer_apply_tag_by_name (priv->buffer, "link", &start, &end);
+}
+
+static void
+insert_text_action (ScratchpadPane *pane,
+                    GtkTextIter    *iter,
+                    gchar          *text,
+                    gint            len)
+{
+  ScratchpadPanePrivate *priv;
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (priv->adding)
+    return;
+
+  scratchpad_links_insert (priv->links, gtk_text_iter_get_offset (iter), 
+                           g_utf8_strlen (text, len));
+}
+
+static void
+delete_range_action (ScratchpadPane *pane,
+                     GtkTextIter    *start,
+                     GtkTextIter    *end)
+{
+  ScratchpadPanePrivate *priv;
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  scratchpad_links_delete (priv->links, gtk_text_iter_get_offset (start), 
+                           gtk_text_iter_get_offset (end));
+}
+
+static gboolean
+button_release_action (ScratchpadPane *pane,
+                       GdkEventButton *event)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter start, end, iter;
+  gint buffer_x, buffer_y;
+  ScratchpadLink *link;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  if (event->button != 1)
+    return FALSE;
+  
+  /* do not jump away while the user is selecting text */
+  gtk_text_buffer_get_selection_bounds (priv->buffer, &start, &end);
+  if (gtk_text_iter_get_offset (&start) != gtk_text_iter_get_offset (&end))
+    return FALSE;
+
+  /* the coordinates are relative to the window that was clicked, which
+     has to be the one the text is drawn in */
+  if (gtk_text_view_get_window_type (GTK_TEXT_VIEW (priv->text_view), 
+                                     event->window) != GTK_TEXT_WINDOW_TEXT)
+    return FALSE;
+
+  gtk_text_view_window_to_buffer_coords (GTK_TEXT_VIEW (priv->text_view),
+                                         GTK_TEXT_WINDOW_TEXT,
+                                         event->x, event->y, 
+                                         &buffer_x, &buffer_y);
+  gtk_text_view_get_iter_at_location (GTK_TEXT_VIEW (priv->text_view), 
+                                      &iter, buffer_x, buffer_y);
+
+  link = scratchpad_links_find (priv->links, gtk_text_iter_get_offset (&iter));
+  if (link == NULL)
+    return FALSE;
+    
+  follow_link (pane, link);
+  return FALSE;
+}
+
+/*
+ * Open the file at the snippet and check that the code is still where the
+ * header says. When it has moved the header is fixed and the editor is 
+ * taken to where it went.
+ */
+static void
+follow_link (ScratchpadPane *pane,
+             ScratchpadLink *link)
+{
+  ScratchpadPanePrivate *priv;
+  CodeSlayerEditor *editor;
+  CodeSlayerDocument *document;
+  const gchar *file_path;
+  gint index;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  /* the link is replaced if the header is rewritten */
+  file_path = link->file_path;
+  index = scratchpad_store_find_id (priv->store, link->id);
+
+  codeslayer_select_editor_by_file_path (priv->codeslayer, file_path, 
+                                         link->line_number);
+  
+  if (index < 0)
+    return;
+  
+  editor = codeslayer_get_active_editor (priv->codeslayer);
+  document = codeslayer_get_active_editor_document (priv->codeslayer);
+  if (editor == NULL || document == NULL || 
+      g_strcmp0 (codeslayer_document_get_file_path (document), file_path) != 0)
+    return;
+
+  if (relocate_snippet (pane, index, gtk_text_view_get_buffer (GTK_TEXT_VIEW (editor))))
+    codeslayer_select_editor_by_file_path (priv->codeslayer, file_path, 
+                                           scratchpad_store_get (priv->store, index)->line_number);
+}
+
+/*
+ * Only the snippets in the buffer are checked against the saved file, the 
+ * rest are checked when their link is followed.
+ */
+static void
+editor_saved_action (ScratchpadPane   *pane,
+                     CodeSlayerEditor *editor)
+{
+  ScratchpadPanePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkTextBuffer *buffer;
+  const gchar *file_path;
+  guint i;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  document = codeslayer_editor_get_document (editor);
+  file_path = g_intern_string (codeslayer_document_get_file_path (document));
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (editor));
+  
+  for (i = priv->window_start; i < priv->window_end; i++)
+    {
+      ScratchpadSnippet *snippet = scratchpad_store_get (priv->store, i);
+      if (snippet->file_path == file_path)
+        relocate_snippet (pane, i, buffer);
+    }
+}
+
+/*
+ * Returns TRUE when the snippet was found on another line.
+ */
+static gboolean
+relocate_snippet (ScratchpadPane *pane,
+                  guint           index,
+                  GtkTextBuffer  *buffer)
+{
+  ScratchpadPanePrivate *priv;
+  ScratchpadSnippet *snippet;
+  gint old_line_number;
+  gint line_number;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  snippet = scratchpad_store_get (priv->store, index);
+  if (snippet->line_number <= 0)
+    return FALSE;
+  
+  if (!scratchpad_anchor_resolve (snippet, buffer, &line_number) || 
+      line_number == snippet->line_number)
+    return FALSE;
+  
+  old_line_number = snippet->line_number;
+  scratchpad_store_set_line (priv->store, index, line_number);
+  scratchpad_search_set_line (priv->search, snippet);
+  scratchpad_palette_set_line (priv->palette, snippet);
+  
+  if (snippet->mark != NULL)
+    rewrite_header (pane, snippet, old_line_number);
+  
+  return TRUE;
+}
+
+/*
+ * Swap the line number in the header of a snippet in the buffer. The old 
+ * link goes with the delete. The header is left alone if it was edited.
+ */
+static void
+rewrite_header (ScratchpadPane    *pane,
+                ScratchpadSnippet *snippet,
+                gint               old_line_number)
+{
+  ScratchpadPanePrivate *priv;
+  GtkTextIter start, end;
+  gchar old_line[SCRATCHPAD_STORE_LINE_SIZE];
+  gchar line[SCRATCHPAD_STORE_LINE_SIZE];
+  gchar *current;
+  gint start_offset;
+  gint length;
+
+  priv = SCRATCHPAD_PANE_GET_PRIVATE (pane);
+  
+  scratchpad_store_format_line (old_line_number, old_line);
+  scratchpad_store_format_line (snippet->line_number, line);
+  
+  length = g_utf8_strlen (snippet->file_path, -1);
+
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, &start, snippet->mark);
+  start_offset = gtk_text_iter_get_offset (&start);
+  gtk_text_iter_forward_chars (&start, 1 + length);
+  end = start;
+  gtk_text_iter_forward_chars (&end, strlen (old_line));
+  
+  current = gtk_text_buffer_get_slice (priv->buffer, &start, &end, TRUE);
+  
+  if (strcmp (current, old_line) == 0)
+    {
+      gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+      gtk_text_buffer_delete (priv->buffer, &start, &end);
+      gtk_text_buffer_insert_with_tags_by_name (priv->buffer, &start, line, -1, "header", NULL);
+      gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (priv->buffer));
+
+      add_link (pane, snippet, start_offset + 1, length + strlen (line));
+    }
+  
+  g_free (current);
+}
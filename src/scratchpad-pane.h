@@ -21,9 +21,17 @@
 
 #include <gtk/gtk.h>
 #include <codeslayer/codeslayer.h>
+#include "scratchpad-store.h"
+#include "scratchpad-journal.h"
 
 G_BEGIN_DECLS
 
+#define SCRATCHPAD_INSERT_MODE "scratchpad_insert_mode"
+#define SCRATCHPAD_INSERT_MODE_TOP "top"
+#define SCRATCHPAD_INSERT_MODE_BOTTOM "bottom"
+#define SCRATCHPAD_VIRTUAL_VIEW "scratchpad_virtual_view"
+#define SCRATCHPAD_MEMORY_BUDGET "scratchpad_memory_budget"
+
 #define SCRATCHPAD_PANE_TYPE            (scratchpad_pane_get_type ())
 #define SCRATCHPAD_PANE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_PANE_TYPE, ScratchpadPane))
 #define SCRATCHPAD_PANE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_PANE_TYPE, ScratchpadPaneClass))
@@ -45,11 +53,35 @@ struct _ScratchpadPaneClass
 
 GType scratchpad_pane_get_type (void) G_GNUC_CONST;
      
-GtkWidget*  scratchpad_pane_new           (CodeSlayer     *codeslayer);
+GtkWidget*        scratchpad_pane_new             (CodeSlayer     *codeslayer);
+
+void              scratchpad_pane_add_text        (ScratchpadPane *pane, 
+                                                   const gchar    *header,
+                                                   const gchar    *text);
+
+ScratchpadSnippet* scratchpad_pane_add_snippet    (ScratchpadPane *pane, 
+                                                   const gchar    *file_path,
+                                                   gint            line_number,
+                                                   gchar          *text);
+
+void              scratchpad_pane_begin_batch     (ScratchpadPane *pane);
+
+void              scratchpad_pane_end_batch       (ScratchpadPane *pane);
+
+void              scratchpad_pane_remove_snippet  (ScratchpadPane *pane,
+                                                   guint           index);
+
+guint             scratchpad_pane_detach_snippet  (ScratchpadPane *pane,
+                                                   guint           id);
+
+gboolean          scratchpad_pane_attach_record   (ScratchpadPane *pane,
+                                                   guint           record,
+                                                   guint          *id);
+
+void              scratchpad_pane_restore         (ScratchpadPane    *pane,
+                                                   ScratchpadJournal *journal);
 
-void        scratchpad_pane_add_text      (ScratchpadPane *pane, 
-                                           const gchar    *header,
-                                           const gchar    *text);
+ScratchpadStore*  scratchpad_pane_get_store       (ScratchpadPane *pane);
 
 G_END_DECLS
 
@@ -19,7 +19,9 @@
 #include <codeslayer/codeslayer.h>
 #include "scratchpad-engine.h"
 #include "scratchpad-menu.h"
-#include "scratchpad-pane.h"
+#include "scratchpad-pads.h"
+#include "scratchpad-stats.h"
+#include "scratchpad-share.h"
 #include <gtk/gtk.h>
 #include <gmodule.h>
 #include <glib.h>
@@ -29,26 +31,74 @@ G_MODULE_EXPORT void deactivate (CodeSlayer *codeslayer);
 
 static ScratchpadEngine *engine;
 static GtkWidget *menu;
-static GtkWidget *pane;
+static GtkWidget *pads;
 
 G_MODULE_EXPORT void
 activate (CodeSlayer *codeslayer)
 {
   GtkAccelGroup *accel_group;
+  CodeSlayerRegistry *registry;
+  gchar *folder_path;
+  gint64 start_time;
+  
+  start_time = g_get_monotonic_time ();
+  
+  /* SCRATCHPAD_STATS=stats.json turns the latency stats on */
+  if (g_getenv (SCRATCHPAD_STATS_ENV) != NULL)
+    scratchpad_stats_enable ();
+
   accel_group = codeslayer_get_menu_bar_accel_group (codeslayer);
   menu = scratchpad_menu_new (accel_group);
-  pane = scratchpad_pane_new (codeslayer);
+  
+  folder_path = g_build_filename (g_get_home_dir (), CODESLAYER_HOME, "plugins", 
+                                  "scratchpad", NULL);
+  pads = scratchpad_pads_new (codeslayer, folder_path);
 
-  engine = scratchpad_engine_new (codeslayer, menu, pane);
+  engine = scratchpad_engine_new (codeslayer, menu, pads);
+  
+  /* instances with the shared pad on see each other's captures */
+  registry = codeslayer_get_registry (codeslayer);
+  if (codeslayer_registry_get_boolean (registry, SCRATCHPAD_SHARED_PAD))
+    {
+      ScratchpadShare *share;
+      gchar *shared_path;
+      
+      shared_path = g_build_filename (folder_path, "shared", NULL);
+      share = scratchpad_share_new (shared_path);
+      scratchpad_engine_set_share (engine, share);
+      g_object_unref (share);
+      g_free (shared_path);
+    }
+  
+  g_free (folder_path);
+  
+  /* besides the menu, every copy made in an editor */
+  if (codeslayer_registry_get_boolean (registry, SCRATCHPAD_AUTO_CAPTURE))
+    scratchpad_engine_set_auto_capture (engine, TRUE);
 
   codeslayer_add_to_menu_bar (codeslayer, GTK_MENU_ITEM (menu));
-  codeslayer_add_to_side_pane (codeslayer, pane, "ScratchPad");
+  codeslayer_add_to_side_pane (codeslayer, pads, "ScratchPad");
+  
+  /* the pads are not opened until they are shown or captured to */
+  if (G_UNLIKELY (scratchpad_stats_enabled))
+    scratchpad_stats_record (SCRATCHPAD_STAT_ACTIVATE, g_get_monotonic_time () - start_time);
 }
 
 G_MODULE_EXPORT void 
 deactivate (CodeSlayer *codeslayer)
 {
+  /* a pad that was never opened is left that way */
+  if (scratchpad_stats_enabled)
+    {
+      ScratchpadStore *store = NULL;
+      
+      if (scratchpad_pads_is_open (SCRATCHPAD_PADS (pads)))
+        store = scratchpad_pane_get_store (scratchpad_pads_get_pane (SCRATCHPAD_PADS (pads)));
+      
+      scratchpad_stats_dump (store, g_getenv (SCRATCHPAD_STATS_ENV));
+    }
+  
   codeslayer_remove_from_menu_bar (codeslayer, GTK_MENU_ITEM (menu));
-  codeslayer_remove_from_side_pane (codeslayer, pane);
+  codeslayer_remove_from_side_pane (codeslayer, pads);
   g_object_unref (engine);
 }
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-search.h"
+
+/*
+ * A trigram index over the snippet headers and bodies. Every run of three
+ * bytes, ascii case folded, maps to the ascending list of snippet ids that 
+ * contain it. A query intersects the lists for its own trigrams and then
+ * checks the few candidates left with a plain substring match.
+ */
+
+static void scratchpad_search_class_init  (ScratchpadSearchClass *klass);
+static void scratchpad_search_init        (ScratchpadSearch      *search);
+static void scratchpad_search_finalize    (ScratchpadSearch      *search);
+
+static void index_text                    (ScratchpadSearch      *search,
+                                           const gchar           *text,
+                                           guint                  id);
+static void add_posting                   (GArray                *ids,
+                                           guint                  id);
+static void backfill                      (ScratchpadSearch      *search);
+static GArray* intersect                  (GArray                *ids,
+                                           GArray                *postings);
+
+#define SCRATCHPAD_SEARCH_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_SEARCH_TYPE, ScratchpadSearchPrivate))
+
+#define TRIGRAM(a, b, c) \
+  (((guint32) g_ascii_tolower (a) << 16) | ((guint32) g_ascii_tolower (b) << 8) | (guint32) g_ascii_tolower (c))
+
+typedef struct _ScratchpadSearchPrivate ScratchpadSearchPrivate;
+
+struct _ScratchpadSearchPrivate
+{
+  ScratchpadStore *store;
+  GHashTable      *postings;
+  gboolean         backfilled;
+};
+
+G_DEFINE_TYPE (ScratchpadSearch, scratchpad_search, G_TYPE_OBJECT)
+
+static void
+scratchpad_search_class_init (ScratchpadSearchClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_search_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadSearchPrivate));
+}
+
+static void
+scratchpad_search_init (ScratchpadSearch *search) 
+{
+  ScratchpadSearchPrivate *priv;
+  priv = SCRATCHPAD_SEARCH_GET_PRIVATE (search);
+  priv->postings = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, 
+                                          (GDestroyNotify) g_array_unref);
+  priv->backfilled = FALSE;
+}
+
+static void
+scratchpad_search_finalize (ScratchpadSearch *search)
+{
+  ScratchpadSearchPrivate *priv;
+  priv = SCRATCHPAD_SEARCH_GET_PRIVATE (search);
+  g_hash_table_destroy (priv->postings);
+  G_OBJECT_CLASS (scratchpad_search_parent_class)->finalize (G_OBJECT (search));
+}
+
+ScratchpadSearch*
+scratchpad_search_new (ScratchpadStore *store)
+{
+  ScratchpadSearchPrivate *priv;
+  ScratchpadSearch *search;
+
+  search = SCRATCHPAD_SEARCH (g_object_new (scratchpad_search_get_type (), NULL));
+  priv = SCRATCHPAD_SEARCH_GET_PRIVATE (search);
+  priv->store = store;
+
+  return search;
+}
+
+/*
+ * The header is indexed as the pad shows it, which is also what the
+ * candidates are checked against.
+ */
+void
+scratchpad_search_add (ScratchpadSearch  *search,
+                       ScratchpadSnippet *snippet)
+{
+  gchar *header;
+  
+  if (snippet->indexed)
+    return;
+  
+  header = scratchpad_store_get_header (snippet);
+  index_text (search, header, snippet->id);
+  index_text (search, snippet->text, snippet->id);
+  g_free (header);
+
+  snippet->indexed = TRUE;
+}
+
+/*
+ * Index the header again after the line of a snippet changed. The 
+ * trigrams of the old line are left, the match on the snippet turns 
+ * them away. 
+ * Snippets that are not indexed yet get the new header when they are.
+ */
+void
+scratchpad_search_set_line (ScratchpadSearch  *search,
+                            ScratchpadSnippet *snippet)
+{
+  gchar *header;
+  
+  if (!snippet->indexed)
+    return;
+  
+  header = scratchpad_store_get_header (snippet);
+  index_text (search, header, snippet->id);
+  g_free (header);
+}
+
+static void
+index_text (ScratchpadSearch *search,
+            const gchar      *text,
+            guint             id)
+{
+  ScratchpadSearchPrivate *priv;
+  const gchar *p;
+
+  priv = SCRATCHPAD_SEARCH_GET_PRIVATE (search);
+  
+  if (text[0] == '\0' || text[1] == '\0')
+    return;
+
+  for (p = text; p[2] != '\0'; p++)
+    {
+      gpointer key;
+      GArray *ids;
+      
+      key = GUINT_TO_POINTER (TRIGRAM (p[0], p[1], p[2]));
+      ids = g_hash_table_lookup (priv->postings, key);
+      if (ids == NULL)
+        {
+          ids = g_array_sized_new (FALSE, FALSE, sizeof (guint), 4);
+          g_hash_table_insert (priv->postings, key, ids);
+        }
+      
+      add_posting (ids, id);
+    }
+}
+
+/*
+ * Keep the ids ascending and without repeats. New captures go on the end, 
+ * restored snippets that are indexed later have to go in before them.
+ */
+static void
+add_posting (GArray *ids,
+             guint   id)
+{
+  guint low, high;
+  
+  if (ids->len == 0 || g_array_index (ids, guint, ids->len - 1) < id)
+    {
+      g_array_append_val (ids, id);
+      return;
+    }
+  
+  low = 0;
+  high = ids->len;
+  while (low < high)
+    {
+      guint middle = (low + high) / 2;
+      if (g_array_index (ids, guint, middle) < id)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+  
+  if (g_array_index (ids, guint, low) != id)
+    g_array_insert_val (ids, low, id);
+}
+
+/*
+ * Snippets restored from the journal are only indexed once somebody 
+ * actually searches, since that means reading every one of them. They are
+ * let go again as it goes so that the budget holds.
+ */
+static void
+backfill (ScratchpadSearch *search)
+{
+  ScratchpadSearchPrivate *priv;
+  guint length;
+  guint i;
+
+  priv = SCRATCHPAD_SEARCH_GET_PRIVATE (search);
+  
+  if (priv->backfilled)
+    return;
+
+  length = scratchpad_store_get_length (priv->store);
+  for (i = 0; i < length; i++)
+    {
+      scratchpad_search_add (search, scratchpad_store_get (priv->store, i));
+      if (i % SCRATCHPAD_STORE_TRIM_INTERVAL == SCRATCHPAD_STORE_TRIM_INTERVAL - 1)
+        scratchpad_store_trim (priv->store);
+    }
+
+  priv->backfilled = TRUE;
+}
+
+/*
+ * Returns the ids of the matching snippets in capture order. Queries that 
+ * are too short to have a trigram have to look at every snippet. Evicted 
+ * snippets that are brought back to be matched can be evicted again before
+ * this returns.
+ */
+GArray*
+scratchpad_search_find (ScratchpadSearch *search,
+                        const gchar      *query)
+{
+  ScratchpadSearchPrivate *priv;
+  GArray *candidates = NULL;
+  GArray *results;
+  const gchar *p;
+  guint i;
+
+  priv = SCRATCHPAD_SEARCH_GET_PRIVATE (search);
+  
+  results = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  if (query == NULL || query[0] == '\0')
+    return results;
+
+  backfill (search);
+  
+  if (strlen (query) < 3)
+    {
+      guint length = scratchpad_store_get_length (priv->store);
+      for (i = 0; i < length; i++)
+        {
+          ScratchpadSnippet *snippet = scratchpad_store_get (priv->store, i);
+          if (scratchpad_search_match_snippet (snippet, query))
+            g_array_append_val (results, snippet->id);
+          if (i % SCRATCHPAD_STORE_TRIM_INTERVAL == SCRATCHPAD_STORE_TRIM_INTERVAL - 1)
+            scratchpad_store_trim (priv->store);
+        }
+      return results;
+    }
+
+  for (p = query; p[2] != '\0'; p++)
+    {
+      GArray *postings;
+      
+      postings = g_hash_table_lookup (priv->postings, 
+                                      GUINT_TO_POINTER (TRIGRAM (p[0], p[1], p[2])));
+      if (postings == NULL)
+        {
+          if (candidates != NULL)
+            g_array_unref (candidates);
+          return results;
+        }
+        
+      candidates = intersect (candidates, postings);
+      if (candidates->len == 0)
+        break;
+    }
+  
+  /* the trigrams can all be there without being next to each other */
+  for (i = 0; i < candidates->len; i++)
+    {
+      guint id = g_array_index (candidates, guint, i);
+      gint index = scratchpad_store_find_id (priv->store, id);
+      if (index >= 0 && 
+          scratchpad_search_match_snippet (scratchpad_store_get (priv->store, index), query))
+        g_array_append_val (results, id);
+      if (i % SCRATCHPAD_STORE_TRIM_INTERVAL == SCRATCHPAD_STORE_TRIM_INTERVAL - 1)
+        scratchpad_store_trim (priv->store);
+    }
+  
+  g_array_unref (candidates);
+
+  return results;
+}
+
+static GArray*
+intersect (GArray *ids,
+           GArray *postings)
+{
+  GArray *result;
+  guint i = 0, j = 0;
+  
+  if (ids == NULL)
+    {
+      result = g_array_sized_new (FALSE, FALSE, sizeof (guint), postings->len);
+      g_array_append_vals (result, postings->data, postings->len);
+      return result;
+    }
+  
+  result = g_array_sized_new (FALSE, FALSE, sizeof (guint), MIN (ids->len, postings->len));
+  
+  while (i < ids->len && j < postings->len)
+    {
+      guint a = g_array_index (ids, guint, i);
+      guint b = g_array_index (postings, guint, j);
+      if (a == b)
+        {
+          g_array_append_val (result, a);
+          i++;
+          j++;
+        }
+      else if (a < b)
+        {
+          i++;
+        }
+      else
+        {
+          j++;
+        }
+    }
+  
+  g_array_unref (ids);
+  
+  return result;
+}
+
+/*
+ * Whether the query is in the text or the header of the snippet. This is
+ * the check behind every result, indexed or not.
+ */
+gboolean
+scratchpad_search_match_snippet (ScratchpadSnippet *snippet,
+                                 const gchar       *query)
+{
+  gchar *header;
+  gboolean matches;
+  
+  if (scratchpad_search_match (snippet->text, query) != NULL)
+    return TRUE;
+    
+  header = scratchpad_store_get_header (snippet);
+  matches = scratchpad_search_match (header, query) != NULL;
+  g_free (header);
+  
+  return matches;
+}
+
+/*
+ * Find the first place the query shows up in the text, ignoring ascii 
+ * case the same way the index does.
+ */
+const gchar*
+scratchpad_search_match (const gchar *text,
+                         const gchar *query)
+{
+  gsize length;
+  const gchar *p;
+  
+  length = strlen (query);
+  
+  for (p = text; *p != '\0'; p++)
+    {
+      if (g_ascii_tolower (*p) == g_ascii_tolower (*query) && 
+          g_ascii_strncasecmp (p, query, length) == 0)
+        return p;
+    }
+    
+  return NULL;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_SEARCH_H__
+#define	__SCRATCHPAD_SEARCH_H__
+
+#include <gtk/gtk.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_SEARCH_TYPE            (scratchpad_search_get_type ())
+#define SCRATCHPAD_SEARCH(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_SEARCH_TYPE, ScratchpadSearch))
+#define SCRATCHPAD_SEARCH_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_SEARCH_TYPE, ScratchpadSearchClass))
+#define IS_SCRATCHPAD_SEARCH(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_SEARCH_TYPE))
+#define IS_SCRATCHPAD_SEARCH_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_SEARCH_TYPE))
+
+typedef struct _ScratchpadSearch ScratchpadSearch;
+typedef struct _ScratchpadSearchClass ScratchpadSearchClass;
+
+struct _ScratchpadSearch
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadSearchClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_search_get_type (void) G_GNUC_CONST;
+
+ScratchpadSearch*  scratchpad_search_new           (ScratchpadStore   *store);
+
+void               scratchpad_search_add           (ScratchpadSearch  *search,
+                                                    ScratchpadSnippet *snippet);
+void               scratchpad_search_set_line      (ScratchpadSearch  *search,
+                                                    ScratchpadSnippet *snippet);
+GArray*            scratchpad_search_find          (ScratchpadSearch  *search,
+                                                    const gchar       *query);
+const gchar*       scratchpad_search_match         (const gchar       *text,
+                                                    const gchar       *query);
+gboolean           scratchpad_search_match_snippet (ScratchpadSnippet *snippet,
+                                                    const gchar       *query);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_SEARCH_H__ */
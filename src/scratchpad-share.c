@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <glib/gstdio.h>
+#include "scratchpad-share.h"
+
+/*
+ * Every instance that shares its pad binds a unix datagram socket, named
+ * after its process, in the shared folder. A snippet is published by
+ * sending it to all the other sockets in there. Sends never block, so a
+ * subscriber that has fallen behind far enough for its socket to fill up
+ * misses the snippet rather than holding up the capture. A socket that
+ * nobody is bound to any more is left over from an instance that went
+ * away and is removed.
+ *
+ * A message is laid out like a journal record, all numbers little endian:
+ *
+ *   guint32 magic
+ *   gint64  timestamp
+ *   gint32  line_number
+ *   guint32 path_size  size of the file path including its nul
+ *   gchar   file_path[path_size]
+ *   gchar   text[]     the rest of the message including its nul
+ */
+
+#define SHARE_MAGIC 0x31485053
+#define MESSAGE_HEADER_SIZE (4 + 8 + 4 + 4)
+#define MAX_MESSAGE_SIZE (64 * 1024)
+
+/* the shared folder is looked at for new peers at most this often */
+#define RESCAN_INTERVAL G_USEC_PER_SEC
+
+/* messages taken off the socket each time the main loop gets to it */
+#define RECEIVE_STEP 64
+
+static void scratchpad_share_class_init  (ScratchpadShareClass *klass);
+static void scratchpad_share_init        (ScratchpadShare      *share);
+static void scratchpad_share_finalize    (ScratchpadShare      *share);
+
+static gboolean bind_socket              (ScratchpadShare      *share);
+static void scan_peers                   (ScratchpadShare      *share);
+static gboolean receive_action           (GIOChannel           *channel,
+                                          GIOCondition          condition,
+                                          ScratchpadShare      *share);
+static gboolean parse_message            (const gchar          *message,
+                                          gsize                 size,
+                                          ScratchpadSnippet    *snippet);
+
+enum
+{
+  RECEIVED,
+  LAST_SIGNAL
+};
+
+static guint scratchpad_share_signals[LAST_SIGNAL] = { 0 };
+
+#define SCRATCHPAD_SHARE_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_SHARE_TYPE, ScratchpadSharePrivate))
+
+typedef struct _ScratchpadSharePrivate ScratchpadSharePrivate;
+
+struct _ScratchpadSharePrivate
+{
+  gchar     *folder_path;
+  gchar     *name;
+  gchar     *socket_path;
+  gint       fd;
+  guint      watch_id;
+  gchar     *buffer;
+  GPtrArray *peers;
+  gint64     scanned;
+};
+
+G_DEFINE_TYPE (ScratchpadShare, scratchpad_share, G_TYPE_OBJECT)
+
+static void
+scratchpad_share_class_init (ScratchpadShareClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  scratchpad_share_signals[RECEIVED] =
+    g_signal_new ("received",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (ScratchpadShareClass, received),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_share_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadSharePrivate));
+}
+
+static void
+scratchpad_share_init (ScratchpadShare *share)
+{
+  ScratchpadSharePrivate *priv;
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+  priv->fd = -1;
+  priv->watch_id = 0;
+  priv->buffer = NULL;
+  priv->peers = g_ptr_array_new_with_free_func (g_free);
+  priv->scanned = 0;
+}
+
+static void
+scratchpad_share_finalize (ScratchpadShare *share)
+{
+  ScratchpadSharePrivate *priv;
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+
+  if (priv->watch_id != 0)
+    g_source_remove (priv->watch_id);
+
+  if (priv->fd != -1)
+    {
+      close (priv->fd);
+      g_unlink (priv->socket_path);
+    }
+
+  g_ptr_array_free (priv->peers, TRUE);
+  g_free (priv->buffer);
+  g_free (priv->folder_path);
+  g_free (priv->name);
+  g_free (priv->socket_path);
+
+  G_OBJECT_CLASS (scratchpad_share_parent_class)->finalize (G_OBJECT (share));
+}
+
+/*
+ * Without a socket the share does nothing, the pad just is not shared.
+ */
+ScratchpadShare*
+scratchpad_share_new (const gchar *folder_path)
+{
+  ScratchpadSharePrivate *priv;
+  ScratchpadShare *share;
+  GIOChannel *channel;
+
+  share = SCRATCHPAD_SHARE (g_object_new (scratchpad_share_get_type (), NULL));
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+
+  priv->folder_path = g_strdup (folder_path);
+  priv->name = g_strdup_printf ("%d", (gint) getpid ());
+  priv->socket_path = g_build_filename (folder_path, priv->name, NULL);
+
+  g_mkdir_with_parents (folder_path, 0700);
+
+  if (!bind_socket (share))
+    return share;
+
+  priv->buffer = g_malloc (MAX_MESSAGE_SIZE);
+
+  channel = g_io_channel_unix_new (priv->fd);
+  priv->watch_id = g_io_add_watch (channel, G_IO_IN, (GIOFunc) receive_action, share);
+  g_io_channel_unref (channel);
+
+  return share;
+}
+
+static gboolean
+bind_socket (ScratchpadShare *share)
+{
+  ScratchpadSharePrivate *priv;
+  struct sockaddr_un address;
+  gint fd;
+
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+
+  if (strlen (priv->socket_path) >= sizeof (address.sun_path))
+    {
+      g_warning ("scratchpad share: %s is too long for a socket", priv->socket_path);
+      return FALSE;
+    }
+
+  fd = socket (AF_UNIX, SOCK_DGRAM, 0);
+  if (fd == -1)
+    {
+      g_warning ("scratchpad share: %s", g_strerror (errno));
+      return FALSE;
+    }
+
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+  fcntl (fd, F_SETFL, O_NONBLOCK);
+
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  strcpy (address.sun_path, priv->socket_path);
+
+  /* left behind by an earlier process with the same id */
+  g_unlink (priv->socket_path);
+
+  if (bind (fd, (struct sockaddr*) &address, sizeof (address)) == -1)
+    {
+      g_warning ("scratchpad share: can not bind %s: %s", priv->socket_path,
+                 g_strerror (errno));
+      close (fd);
+      return FALSE;
+    }
+
+  priv->fd = fd;
+  return TRUE;
+}
+
+/*
+ * Runs on the capture worker, which is the only thread that ever looks at
+ * the peers, so publishing takes no locks. A snippet too big for a single
+ * message stays local.
+ */
+void
+scratchpad_share_publish (ScratchpadShare   *share,
+                          ScratchpadSnippet *snippet)
+{
+  ScratchpadSharePrivate *priv;
+  guint32 path_size, text_size;
+  guint32 magic, line_number, value;
+  gint64 timestamp;
+  gint64 now;
+  gchar *message;
+  gsize size;
+  guint i;
+
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+
+  if (priv->fd == -1)
+    return;
+
+  path_size = strlen (snippet->file_path) + 1;
+  text_size = strlen (snippet->text) + 1;
+  size = MESSAGE_HEADER_SIZE + path_size + text_size;
+
+  /* the other instances only miss out on what is too big for a message */
+  if (size > MAX_MESSAGE_SIZE)
+    return;
+
+  now = g_get_monotonic_time ();
+  if (now - priv->scanned > RESCAN_INTERVAL)
+    {
+      scan_peers (share);
+      priv->scanned = now;
+    }
+
+  if (priv->peers->len == 0)
+    return;
+
+  magic = GUINT32_TO_LE (SHARE_MAGIC);
+  timestamp = GINT64_TO_LE (snippet->timestamp);
+  line_number = GUINT32_TO_LE ((guint32) snippet->line_number);
+  value = GUINT32_TO_LE (path_size);
+
+  message = g_malloc (size);
+  memcpy (message, &magic, 4);
+  memcpy (message + 4, &timestamp, 8);
+  memcpy (message + 12, &line_number, 4);
+  memcpy (message + 16, &value, 4);
+  memcpy (message + MESSAGE_HEADER_SIZE, snippet->file_path, path_size);
+  memcpy (message + MESSAGE_HEADER_SIZE + path_size, snippet->text, text_size);
+
+  for (i = 0; i < priv->peers->len;)
+    {
+      struct sockaddr_un *address = g_ptr_array_index (priv->peers, i);
+
+      /* a full socket just drops the message */
+      if (sendto (priv->fd, message, size, MSG_DONTWAIT | MSG_NOSIGNAL,
+                  (struct sockaddr*) address, sizeof (struct sockaddr_un)) == -1 &&
+          (errno == ECONNREFUSED || errno == ENOENT))
+        {
+          g_unlink (address->sun_path);
+          g_ptr_array_remove_index_fast (priv->peers, i);
+          continue;
+        }
+
+      i++;
+    }
+
+  g_free (message);
+}
+
+static void
+scan_peers (ScratchpadShare *share)
+{
+  ScratchpadSharePrivate *priv;
+  const gchar *file_name;
+  GDir *dir;
+
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+
+  g_ptr_array_set_size (priv->peers, 0);
+
+  dir = g_dir_open (priv->folder_path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((file_name = g_dir_read_name (dir)) != NULL)
+    {
+      struct sockaddr_un *address;
+      gchar *path;
+
+      if (strcmp (file_name, priv->name) == 0)
+        continue;
+
+      path = g_build_filename (priv->folder_path, file_name, NULL);
+
+      if (strlen (path) < sizeof (address->sun_path))
+        {
+          address = g_new0 (struct sockaddr_un, 1);
+          address->sun_family = AF_UNIX;
+          strcpy (address->sun_path, path);
+          g_ptr_array_add (priv->peers, address);
+        }
+
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+}
+
+/*
+ * The snippet handed to the signal points into the receive buffer, so
+ * whatever is kept of it has to be copied.
+ */
+static gboolean
+receive_action (GIOChannel      *channel,
+                GIOCondition     condition,
+                ScratchpadShare *share)
+{
+  ScratchpadSharePrivate *priv;
+  ScratchpadSnippet snippet;
+  gssize size;
+  guint i;
+
+  priv = SCRATCHPAD_SHARE_GET_PRIVATE (share);
+
+  for (i = 0; i < RECEIVE_STEP; i++)
+    {
+      size = recv (priv->fd, priv->buffer, MAX_MESSAGE_SIZE, MSG_DONTWAIT);
+      if (size < 0)
+        break;
+
+      if (parse_message (priv->buffer, size, &snippet))
+        g_signal_emit (share, scratchpad_share_signals[RECEIVED], 0, &snippet);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+parse_message (const gchar       *message,
+               gsize              size,
+               ScratchpadSnippet *snippet)
+{
+  guint32 magic, line_number, path_size;
+  gint64 timestamp;
+
+  if (size <= MESSAGE_HEADER_SIZE || message[size - 1] != '\0')
+    return FALSE;
+
+  memcpy (&magic, message, 4);
+  memcpy (&timestamp, message + 4, 8);
+  memcpy (&line_number, message + 12, 4);
+  memcpy (&path_size, message + 16, 4);
+  path_size = GUINT32_FROM_LE (path_size);
+
+  if (GUINT32_FROM_LE (magic) != SHARE_MAGIC || path_size == 0 ||
+      path_size >= size - MESSAGE_HEADER_SIZE ||
+      message[MESSAGE_HEADER_SIZE + path_size - 1] != '\0')
+    return FALSE;
+
+  memset (snippet, 0, sizeof (ScratchpadSnippet));
+  snippet->file_path = g_intern_string (message + MESSAGE_HEADER_SIZE);
+  snippet->line_number = (gint) GUINT32_FROM_LE (line_number);
+  snippet->text = (gchar*) message + MESSAGE_HEADER_SIZE + path_size;
+  snippet->timestamp = GINT64_FROM_LE (timestamp);
+  snippet->record = G_MAXUINT;
+
+  return TRUE;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_SHARE_H__
+#define	__SCRATCHPAD_SHARE_H__
+
+#include <gtk/gtk.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_SHARED_PAD "scratchpad_shared_pad"
+
+#define SCRATCHPAD_SHARE_TYPE            (scratchpad_share_get_type ())
+#define SCRATCHPAD_SHARE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_SHARE_TYPE, ScratchpadShare))
+#define SCRATCHPAD_SHARE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_SHARE_TYPE, ScratchpadShareClass))
+#define IS_SCRATCHPAD_SHARE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_SHARE_TYPE))
+#define IS_SCRATCHPAD_SHARE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_SHARE_TYPE))
+
+typedef struct _ScratchpadShare ScratchpadShare;
+typedef struct _ScratchpadShareClass ScratchpadShareClass;
+
+struct _ScratchpadShare
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadShareClass
+{
+  GObjectClass parent_class;
+
+  void (*received) (ScratchpadShare   *share,
+                    ScratchpadSnippet *snippet);
+};
+
+GType scratchpad_share_get_type (void) G_GNUC_CONST;
+
+ScratchpadShare*  scratchpad_share_new      (const gchar       *folder_path);
+
+void              scratchpad_share_publish  (ScratchpadShare   *share,
+                                             ScratchpadSnippet *snippet);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_SHARE_H__ */
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "scratchpad-stats.h"
+
+/*
+ * Latency histograms for the stages of a capture, and for the pad's other 
+ * operations that can get slow as it grows. Each stage has buckets
+ * that are a quarter of a power of two wide, so the percentiles come out
+ * within a quarter of the real value whatever the range, in a fixed bit 
+ * of memory. Stages run on the main loop and on the capture worker so 
+ * the recording is locked, which only matters once the stats are on.
+ */
+
+#define BUCKETS 168
+
+typedef struct
+{
+  guint64 count;
+  gint64  total;
+  gint64  max;
+  guint64 buckets[BUCKETS];
+} Histogram;
+
+static guint get_bucket         (gint64     usec);
+static gint64 get_bucket_limit  (guint      bucket);
+static gint64 get_percentile    (Histogram *histogram,
+                                 gdouble    percentile);
+
+gboolean scratchpad_stats_enabled = FALSE;
+
+static GMutex lock;
+static Histogram histograms[SCRATCHPAD_STAT_LAST];
+
+static const gchar *STAT_NAMES[SCRATCHPAD_STAT_LAST] = 
+{
+  "extract",
+  "show_pane",
+  "journal",
+  "add",
+  "header",
+  "insert",
+  "link",
+  "activate",
+  "open",
+  "switch",
+  "search",
+  "palette",
+  "diff",
+  "import",
+  "export"
+};
+
+void
+scratchpad_stats_enable (void)
+{
+  scratchpad_stats_enabled = TRUE;
+}
+
+void
+scratchpad_stats_record (ScratchpadStat stat,
+                         gint64         usec)
+{
+  Histogram *histogram;
+  
+  histogram = &histograms[stat];
+  
+  g_mutex_lock (&lock);
+  histogram->count++;
+  histogram->total += usec;
+  histogram->max = MAX (histogram->max, usec);
+  histogram->buckets[get_bucket (usec)]++;
+  g_mutex_unlock (&lock);
+}
+
+/*
+ * A line of json per stage and one for the pad itself, if it was ever 
+ * opened.
+ */
+gchar*
+scratchpad_stats_report (ScratchpadStore *store)
+{
+  GString *report;
+  guint i;
+  
+  report = g_string_new (NULL);
+  
+  g_mutex_lock (&lock);
+  
+  for (i = 0; i < SCRATCHPAD_STAT_LAST; i++)
+    {
+      Histogram *histogram = &histograms[i];
+      
+      g_string_append_printf (report, 
+                              "{\"stat\": \"%s\", \"count\": %" G_GUINT64_FORMAT ", "
+                              "\"mean_usec\": %.1f, \"p50_usec\": %" G_GINT64_FORMAT ", "
+                              "\"p99_usec\": %" G_GINT64_FORMAT ", \"max_usec\": %" G_GINT64_FORMAT "}\n",
+                              STAT_NAMES[i], histogram->count, 
+                              histogram->count > 0 ? (gdouble) histogram->total / histogram->count : 0.0,
+                              get_percentile (histogram, 0.5), 
+                              get_percentile (histogram, 0.99), 
+                              histogram->max);
+    }
+  
+  g_mutex_unlock (&lock);
+  
+  if (store == NULL)
+    return g_string_free (report, FALSE);
+  
+  g_string_append_printf (report, 
+                          "{\"stat\": \"pad\", \"snippets\": %u, \"bytes_held\": %" G_GSIZE_FORMAT "}\n",
+                          scratchpad_store_get_length (store), 
+                          scratchpad_store_get_resident (store));
+
+  return g_string_free (report, FALSE);
+}
+
+gboolean
+scratchpad_stats_dump (ScratchpadStore *store,
+                       const gchar     *file_name)
+{
+  GError *error = NULL;
+  gchar *report;
+  
+  report = scratchpad_stats_report (store);
+  
+  if (!g_file_set_contents (file_name, report, -1, &error))
+    {
+      g_warning ("scratchpad stats: %s", error->message);
+      g_error_free (error);
+      g_free (report);
+      return FALSE;
+    }
+  
+  g_free (report);
+  return TRUE;
+}
+
+/*
+ * Below 4 every value has a bucket of its own. Above that the highest bit 
+ * picks the group of 4 and the two bits under it the bucket within it.
+ */
+static guint
+get_bucket (gint64 usec)
+{
+  gint msb;
+  
+  if (usec < 4)
+    return MAX (usec, 0);
+  
+  msb = g_bit_nth_msf (usec, -1);
+  
+  return MIN ((msb - 1) * 4 + ((usec >> (msb - 2)) & 3), BUCKETS - 1);
+}
+
+static gint64
+get_bucket_limit (guint bucket)
+{
+  gint msb;
+  
+  if (bucket < 4)
+    return bucket;
+  
+  msb = bucket / 4 + 1;
+  
+  return ((gint64) (4 + bucket % 4 + 1) << (msb - 2)) - 1;
+}
+
+static gint64
+get_percentile (Histogram *histogram,
+                gdouble    percentile)
+{
+  guint64 target;
+  guint64 seen = 0;
+  guint i;
+  
+  if (histogram->count == 0)
+    return 0;
+  
+  target = MAX ((guint64) (histogram->count * percentile + 0.5), 1);
+  
+  for (i = 0; i < BUCKETS; i++)
+    {
+      seen += histogram->buckets[i];
+      if (seen >= target)
+        return MIN (get_bucket_limit (i), histogram->max);
+    }
+  
+  return histogram->max;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_STATS_H__
+#define	__SCRATCHPAD_STATS_H__
+
+#include <gtk/gtk.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_STATS_ENV "SCRATCHPAD_STATS"
+
+typedef enum
+{
+  SCRATCHPAD_STAT_EXTRACT,
+  SCRATCHPAD_STAT_SHOW_PANE,
+  SCRATCHPAD_STAT_JOURNAL,
+  SCRATCHPAD_STAT_ADD,
+  SCRATCHPAD_STAT_HEADER,
+  SCRATCHPAD_STAT_INSERT,
+  SCRATCHPAD_STAT_LINK,
+  SCRATCHPAD_STAT_ACTIVATE,
+  SCRATCHPAD_STAT_OPEN,
+  SCRATCHPAD_STAT_SWITCH,
+  SCRATCHPAD_STAT_SEARCH,
+  SCRATCHPAD_STAT_PALETTE,
+  SCRATCHPAD_STAT_DIFF,
+  SCRATCHPAD_STAT_IMPORT,
+  SCRATCHPAD_STAT_EXPORT,
+  SCRATCHPAD_STAT_LAST
+} ScratchpadStat;
+
+extern gboolean scratchpad_stats_enabled;
+
+/* 
+ * With the stats off a stage costs a test of the flag. A start of 0 means
+ * nothing is recorded at the stop.
+ */
+#define SCRATCHPAD_STATS_START() \
+  (G_UNLIKELY (scratchpad_stats_enabled) ? g_get_monotonic_time () : 0)
+
+#define SCRATCHPAD_STATS_STOP(stat, start) G_STMT_START { \
+  if (G_UNLIKELY ((start) != 0)) \
+    scratchpad_stats_record ((stat), g_get_monotonic_time () - (start)); \
+} G_STMT_END
+
+void      scratchpad_stats_enable  (void);
+void      scratchpad_stats_record  (ScratchpadStat   stat,
+                                    gint64           usec);
+gchar*    scratchpad_stats_report  (ScratchpadStore *store);
+gboolean  scratchpad_stats_dump    (ScratchpadStore *store,
+                                    const gchar     *file_name);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_STATS_H__ */
@@ -0,0 +1,788 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-store.h"
+#include "scratchpad-journal.h"
+
+static void scratchpad_store_class_init  (ScratchpadStoreClass *klass);
+static void scratchpad_store_init        (ScratchpadStore      *store);
+static void scratchpad_store_finalize    (ScratchpadStore      *store);
+
+typedef struct
+{
+  guint        hash;
+  const gchar *text;
+  const gchar *file_path;
+  gint         line_number;
+} Location;
+
+static void snippet_clear                (ScratchpadStore      *store,
+                                          ScratchpadSnippet    *snippet);
+static void load_snippet                 (ScratchpadStore      *store,
+                                          ScratchpadSnippet    *snippet);
+static gboolean evict_snippet            (ScratchpadStore      *store,
+                                          ScratchpadSnippet    *snippet);
+static void touch_snippet                (ScratchpadStore      *store,
+                                          ScratchpadSnippet    *snippet);
+static GBytes* pack_text                 (const gchar          *text);
+static gchar* unpack_text                (GBytes               *packed);
+static const gchar* share_text           (ScratchpadStore      *store,
+                                          gchar                *text);
+static void release_text                 (ScratchpadStore      *store,
+                                          const gchar          *text);
+static void add_location                 (ScratchpadStore      *store,
+                                          ScratchpadSnippet    *snippet,
+                                          guint                 hash);
+static void remove_location              (ScratchpadStore      *store,
+                                          ScratchpadSnippet    *snippet);
+static guint location_hash               (Location             *location);
+static gboolean location_equal           (Location             *location1,
+                                          Location             *location2);
+static void location_free                (Location             *location);
+
+#define SCRATCHPAD_STORE_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_STORE_TYPE, ScratchpadStorePrivate))
+
+typedef struct _ScratchpadStorePrivate ScratchpadStorePrivate;
+
+struct _ScratchpadStorePrivate
+{
+  GArray            *snippets;
+  ScratchpadJournal *journal;
+  guint              next_id;
+  GHashTable        *bodies;
+  GHashTable        *locations;
+  GQueue            *used;
+  gsize              resident;
+  gsize              budget;
+};
+
+G_DEFINE_TYPE (ScratchpadStore, scratchpad_store, G_TYPE_OBJECT)
+
+static void
+scratchpad_store_class_init (ScratchpadStoreClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_store_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadStorePrivate));
+}
+
+static void
+scratchpad_store_init (ScratchpadStore *store) 
+{
+  ScratchpadStorePrivate *priv;
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  priv->snippets = g_array_new (FALSE, FALSE, sizeof (ScratchpadSnippet));
+  priv->journal = NULL;
+  priv->next_id = 0;
+  priv->bodies = g_hash_table_new (g_str_hash, g_str_equal);
+  priv->locations = g_hash_table_new_full ((GHashFunc) location_hash, 
+                                           (GEqualFunc) location_equal,
+                                           (GDestroyNotify) location_free, NULL);
+  priv->used = g_queue_new ();
+  priv->resident = 0;
+  priv->budget = 0;
+}
+
+static void
+scratchpad_store_finalize (ScratchpadStore *store)
+{
+  ScratchpadStorePrivate *priv;
+  guint i;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  for (i = 0; i < priv->snippets->len; i++)
+    snippet_clear (store, &g_array_index (priv->snippets, ScratchpadSnippet, i));
+
+  g_array_free (priv->snippets, TRUE);
+  g_hash_table_destroy (priv->bodies);
+  g_hash_table_destroy (priv->locations);
+  g_queue_free (priv->used);
+  
+  if (priv->journal != NULL)
+    g_object_unref (priv->journal);
+
+  G_OBJECT_CLASS (scratchpad_store_parent_class)->finalize (G_OBJECT (store));
+}
+
+ScratchpadStore*
+scratchpad_store_new (void)
+{
+  return SCRATCHPAD_STORE (g_object_new (scratchpad_store_get_type (), NULL));
+}
+
+/*
+ * Take over the journal's snippets. New snippets are written to it by the
+ * capture worker, removed ones are taken out here. Only the record numbers 
+ * are taken, each snippet is read from the journal the first time it is 
+ * asked for.
+ */
+void
+scratchpad_store_set_journal (ScratchpadStore   *store,
+                              ScratchpadJournal *journal)
+{
+  ScratchpadStorePrivate *priv;
+  guint length;
+  guint i;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  priv->journal = g_object_ref (journal);
+  
+  length = scratchpad_journal_get_length (priv->journal);
+  
+  for (i = 0; i < length; i++)
+    {
+      ScratchpadSnippet snippet;
+
+      if (scratchpad_journal_is_removed (priv->journal, i))
+        continue;
+        
+      memset (&snippet, 0, sizeof (ScratchpadSnippet));
+      snippet.id = priv->next_id++;
+      snippet.record = i;
+      snippet.count = 1;
+      g_array_append_val (priv->snippets, snippet);
+    }
+}
+
+ScratchpadJournal*
+scratchpad_store_get_journal (ScratchpadStore *store)
+{
+  ScratchpadStorePrivate *priv;
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  return priv->journal;
+}
+
+/*
+ * The snippets are kept in capture order. File paths are interned since
+ * the same handful of files tend to be copied from over and over. The 
+ * store takes over the text rather than copying it. 
+ *
+ * Copying the same text from the same place again does not add anything, 
+ * the snippet that is already there has its count and timestamp bumped and
+ * is handed back instead. The same text copied from somewhere else is a 
+ * new snippet but shares the text of the first one.
+ */
+ScratchpadSnippet*
+scratchpad_store_add (ScratchpadStore *store,
+                      const gchar     *file_path,
+                      gint             line_number,
+                      gchar           *text)
+{
+  ScratchpadStorePrivate *priv;
+  ScratchpadSnippet snippet;
+  ScratchpadSnippet *result;
+  Location location;
+  gpointer id;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  location.hash = g_str_hash (text);
+  location.text = text;
+  location.file_path = g_intern_string (file_path);
+  location.line_number = line_number;
+  
+  if (g_hash_table_lookup_extended (priv->locations, &location, NULL, &id))
+    {
+      result = &g_array_index (priv->snippets, ScratchpadSnippet, 
+                               scratchpad_store_find_id (store, GPOINTER_TO_UINT (id)));
+      result->count++;
+      result->timestamp = g_get_real_time ();
+      touch_snippet (store, result);
+      g_free (text);
+      return result;
+    }
+  
+  snippet.file_path = location.file_path;
+  snippet.line_number = line_number;
+  snippet.text = (gchar*) share_text (store, text);
+  snippet.timestamp = g_get_real_time ();
+  snippet.mark = NULL;
+  snippet.highlights = NULL;
+  snippet.packed = NULL;
+  snippet.used = NULL;
+  snippet.id = priv->next_id++;
+  snippet.loaded = TRUE;
+  snippet.mapped = FALSE;
+  snippet.indexed = FALSE;
+  snippet.listed = FALSE;
+  snippet.anchored = FALSE;
+  snippet.painted = FALSE;
+  snippet.record = G_MAXUINT;
+  snippet.count = 1;
+  
+  g_array_append_val (priv->snippets, snippet);
+  
+  result = &g_array_index (priv->snippets, ScratchpadSnippet, priv->snippets->len - 1);
+  add_location (store, result, location.hash);
+  touch_snippet (store, result);
+  
+  /* the new snippet is the most recently used, which trim never evicts */
+  scratchpad_store_trim (store);
+  
+  return result;
+}
+
+ScratchpadSnippet*
+scratchpad_store_get (ScratchpadStore *store,
+                      guint            index)
+{
+  ScratchpadStorePrivate *priv;
+  ScratchpadSnippet *snippet;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  if (index >= priv->snippets->len)
+    return NULL;
+
+  snippet = &g_array_index (priv->snippets, ScratchpadSnippet, index);
+  
+  if (!snippet->loaded)
+    load_snippet (store, snippet);
+  else
+    touch_snippet (store, snippet);
+  
+  return snippet;
+}
+
+guint
+scratchpad_store_get_length (ScratchpadStore *store)
+{
+  ScratchpadStorePrivate *priv;
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  return priv->snippets->len;
+}
+
+/*
+ * Ids are handed out in capture order and never reused, so unlike the 
+ * index of a snippet they stay put when others are removed.
+ */
+gint
+scratchpad_store_find_id (ScratchpadStore *store,
+                          guint            id)
+{
+  ScratchpadStorePrivate *priv;
+  gint low, high;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  low = 0;
+  high = priv->snippets->len - 1;
+  
+  while (low <= high)
+    {
+      ScratchpadSnippet *snippet;
+      gint middle;
+      
+      middle = (low + high) / 2;
+      snippet = &g_array_index (priv->snippets, ScratchpadSnippet, middle);
+      
+      if (snippet->id == id)
+        return middle;
+      if (snippet->id < id)
+        low = middle + 1;
+      else
+        high = middle - 1;
+    }
+    
+  return -1;
+}
+
+void
+scratchpad_store_remove (ScratchpadStore *store,
+                         guint            index)
+{
+  ScratchpadStorePrivate *priv;
+  guint record;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  record = scratchpad_store_detach (store, index);
+  
+  if (priv->journal != NULL && record != G_MAXUINT)
+    scratchpad_journal_remove (priv->journal, record);
+}
+
+/*
+ * Take the snippet out but leave its record in the journal so that it 
+ * can be read back again. Returns the record.
+ */
+guint
+scratchpad_store_detach (ScratchpadStore *store,
+                         guint            index)
+{
+  ScratchpadStorePrivate *priv;
+  ScratchpadSnippet *snippet;
+  guint record;
+
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  if (index >= priv->snippets->len)
+    return G_MAXUINT;
+
+  snippet = &g_array_index (priv->snippets, ScratchpadSnippet, index);
+  record = snippet->record;
+
+  snippet_clear (store, snippet);
+  g_array_remove_index (priv->snippets, index);
+  
+  return record;
+}
+
+/*
+ * Move the snippet to where its code is now. 
+ */
+void
+scratchpad_store_set_line (ScratchpadStore *store,
+                           guint            index,
+                           gint             line_number)
+{
+  ScratchpadSnippet *snippet;
+  
+  snippet = scratchpad_store_get (store, index);
+  if (snippet == NULL)
+    return;
+  
+  remove_location (store, snippet);
+  snippet->line_number = line_number;
+  add_location (store, snippet, g_str_hash (snippet->text));
+}
+
+/*
+ * The most text in bytes that is kept in memory, or 0 for no limit. Text 
+ * mapped from the journal does not count. Text of snippets that are in the
+ * buffer does, but it is never evicted, so those alone can go over.
+ */
+void
+scratchpad_store_set_budget (ScratchpadStore *store,
+                             gsize            budget)
+{
+  ScratchpadStorePrivate *priv;
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  priv->budget = budget;
+  scratchpad_store_trim (store);
+}
+
+/*
+ * Evict the least recently used snippets until the text in memory fits 
+ * the budget. Snippets that are in the buffer are passed over, and so is 
+ * the most recently used one, which is the one just added or asked for 
+ * and may be bigger than the whole budget. Any other snippet that was 
+ * asked for earlier can lose its text here, so this is only called when 
+ * nothing is holding on to one.
+ */
+void
+scratchpad_store_trim (ScratchpadStore *store)
+{
+  ScratchpadStorePrivate *priv;
+  guint length;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  length = g_queue_get_length (priv->used);
+  
+  /* the tail is only reached on the last pass, which is never made */
+  while (priv->budget > 0 && priv->resident > priv->budget && length-- > 1)
+    {
+      ScratchpadSnippet *snippet;
+      GList *used;
+      
+      used = g_queue_pop_head_link (priv->used);
+      snippet = &g_array_index (priv->snippets, ScratchpadSnippet, 
+                                scratchpad_store_find_id (store, GPOINTER_TO_UINT (used->data)));
+      
+      if (snippet->mark != NULL || !evict_snippet (store, snippet))
+        {
+          g_queue_push_tail_link (priv->used, used);
+          continue;
+        }
+      
+      g_list_free_1 (used);
+      snippet->used = NULL;
+    }
+}
+
+/*
+ * The bytes of text held in memory, shared text counted once.
+ */
+gsize
+scratchpad_store_get_resident (ScratchpadStore *store)
+{
+  ScratchpadStorePrivate *priv;
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  return priv->resident;
+}
+
+/*
+ * The header is the file path and the line part. The pad shows it and the
+ * search indexes and matches it, so they all go through here.
+ */
+gchar*
+scratchpad_store_get_header (ScratchpadSnippet *snippet)
+{
+  gchar line[SCRATCHPAD_STORE_LINE_SIZE];
+  scratchpad_store_format_line (snippet->line_number, line);
+  return g_strconcat (snippet->file_path, line, NULL);
+}
+
+/*
+ * Write the line part of a header into a buffer of 
+ * SCRATCHPAD_STORE_LINE_SIZE, for when the pad puts it in piece by piece.
+ */
+void
+scratchpad_store_format_line (gint   line_number,
+                              gchar *line)
+{
+  g_snprintf (line, SCRATCHPAD_STORE_LINE_SIZE, ":%d", line_number);
+}
+
+/*
+ * The marks belong to the buffer and are deleted by the view. Mapped text 
+ * belongs to the journal.
+ */
+static void
+snippet_clear (ScratchpadStore   *store,
+               ScratchpadSnippet *snippet)
+{
+  ScratchpadStorePrivate *priv;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  if (snippet->used != NULL)
+    g_queue_delete_link (priv->used, snippet->used);
+  
+  if (snippet->packed != NULL)
+    g_bytes_unref (snippet->packed);
+  
+  if (snippet->highlights != NULL)
+    g_array_unref (snippet->highlights);
+
+  /* snippets that were never read or have been evicted have no text */
+  if (!snippet->loaded)
+    return;
+  
+  remove_location (store, snippet);
+
+  if (!snippet->mapped)
+    release_text (store, snippet->text);
+}
+
+/*
+ * Bring back the text of a snippet that was restored lazily or evicted, 
+ * either from its compressed copy or from the journal. Only a snippet that
+ * was never read takes its place and time from the journal, an evicted one
+ * may have been moved or captured again since it was written.
+ */
+static void
+load_snippet (ScratchpadStore   *store,
+              ScratchpadSnippet *snippet)
+{
+  ScratchpadStorePrivate *priv;
+  ScratchpadSnippet saved;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  snippet->loaded = TRUE;
+  
+  if (snippet->packed != NULL)
+    {
+      snippet->text = (gchar*) share_text (store, unpack_text (snippet->packed));
+      g_bytes_unref (snippet->packed);
+      snippet->packed = NULL;
+      snippet->mapped = FALSE;
+      touch_snippet (store, snippet);
+    }
+  else
+    {
+      saved.record = snippet->record;
+      snippet->mapped = priv->journal != NULL && 
+                        scratchpad_journal_read (priv->journal, &saved);
+      
+      if (snippet->mapped && snippet->file_path == NULL)
+        {
+          snippet->file_path = saved.file_path;
+          snippet->line_number = saved.line_number;
+          snippet->timestamp = saved.timestamp;
+        }
+      
+      if (snippet->mapped)
+        {
+          snippet->text = saved.text;
+        }
+      else
+        {
+          if (snippet->file_path == NULL)
+            snippet->file_path = g_intern_static_string ("");
+          snippet->text = (gchar*) share_text (store, g_strdup (""));
+        }
+    }
+
+  add_location (store, snippet, g_str_hash (snippet->text));
+}
+
+/*
+ * A snippet that is in the journal can be read back from it, anything 
+ * else is compressed. Returns FALSE when the snippet has to stay as is.
+ */
+static gboolean
+evict_snippet (ScratchpadStore   *store,
+               ScratchpadSnippet *snippet)
+{
+  ScratchpadStorePrivate *priv;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  if (priv->journal == NULL || snippet->record == G_MAXUINT)
+    {
+      snippet->packed = pack_text (snippet->text);
+      if (snippet->packed == NULL)
+        return FALSE;
+    }
+  
+  remove_location (store, snippet);
+  release_text (store, snippet->text);
+  snippet->text = NULL;
+  snippet->loaded = FALSE;
+  
+  /* worked out again if the snippet is shown again */
+  if (snippet->highlights != NULL)
+    {
+      g_array_unref (snippet->highlights);
+      snippet->highlights = NULL;
+    }
+  
+  return TRUE;
+}
+
+/*
+ * Only text that is held in memory is tracked, which is what is left 
+ * once the journal mapping is accounted for.
+ */
+static void
+touch_snippet (ScratchpadStore   *store,
+               ScratchpadSnippet *snippet)
+{
+  ScratchpadStorePrivate *priv;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  if (snippet->mapped)
+    return;
+  
+  if (snippet->used == NULL)
+    {
+      snippet->used = g_list_alloc ();
+      snippet->used->data = GUINT_TO_POINTER (snippet->id);
+    }
+  else
+    {
+      g_queue_unlink (priv->used, snippet->used);
+    }
+
+  g_queue_push_tail_link (priv->used, snippet->used);
+}
+
+/*
+ * Deflate at the fastest level, with the length of the text in front so 
+ * that it can be inflated in one go. NULL when it would not save anything.
+ */
+static GBytes*
+pack_text (const gchar *text)
+{
+  GConverter *compressor;
+  GConverterResult result;
+  guint32 length;
+  gsize size;
+  gsize bytes_read;
+  gsize bytes_written;
+  guchar *data;
+
+  length = strlen (text);
+  size = sizeof (guint32) + length;
+  data = g_malloc (size);
+  memcpy (data, &length, sizeof (guint32));
+  
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, 1));
+  result = g_converter_convert (compressor, text, length, 
+                                data + sizeof (guint32), size - sizeof (guint32), 
+                                G_CONVERTER_INPUT_AT_END, 
+                                &bytes_read, &bytes_written, NULL);
+  g_object_unref (compressor);
+  
+  if (result != G_CONVERTER_FINISHED)
+    {
+      g_free (data);
+      return NULL;
+    }
+
+  size = sizeof (guint32) + bytes_written;
+  return g_bytes_new_take (g_realloc (data, size), size);
+}
+
+static gchar*
+unpack_text (GBytes *packed)
+{
+  GConverter *decompressor;
+  const guchar *data;
+  guint32 length;
+  gsize size;
+  gsize bytes_read;
+  gsize bytes_written;
+  gchar *text;
+
+  data = g_bytes_get_data (packed, &size);
+  memcpy (&length, data, sizeof (guint32));
+  
+  text = g_malloc (length + 1);
+  
+  decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+  g_converter_convert (decompressor, data + sizeof (guint32), size - sizeof (guint32), 
+                       text, length, G_CONVERTER_INPUT_AT_END, 
+                       &bytes_read, &bytes_written, NULL);
+  g_object_unref (decompressor);
+  
+  text[bytes_written] = '\0';
+  
+  return text;
+}
+
+/*
+ * Text that is already in the store is used in place of the new copy, 
+ * which is freed. The bodies table counts the snippets using each text.
+ */
+static const gchar*
+share_text (ScratchpadStore *store,
+            gchar           *text)
+{
+  ScratchpadStorePrivate *priv;
+  gpointer shared;
+  gpointer count;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  if (g_hash_table_lookup_extended (priv->bodies, text, &shared, &count))
+    {
+      g_free (text);
+      g_hash_table_insert (priv->bodies, shared, 
+                           GUINT_TO_POINTER (GPOINTER_TO_UINT (count) + 1));
+      return shared;
+    }
+
+  g_hash_table_insert (priv->bodies, text, GUINT_TO_POINTER (1));
+  priv->resident += strlen (text) + 1;
+  return text;
+}
+
+static void
+release_text (ScratchpadStore *store,
+              const gchar     *text)
+{
+  ScratchpadStorePrivate *priv;
+  guint count;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->bodies, text));
+  
+  if (count > 1)
+    {
+      g_hash_table_insert (priv->bodies, (gpointer) text, GUINT_TO_POINTER (count - 1));
+      return;
+    }
+  
+  g_hash_table_remove (priv->bodies, text);
+  priv->resident -= strlen (text) + 1;
+  g_free ((gchar*) text);
+}
+
+/*
+ * The first snippet from a place with a given text is the one later 
+ * copies are folded into.
+ */
+static void
+add_location (ScratchpadStore   *store,
+              ScratchpadSnippet *snippet,
+              guint              hash)
+{
+  ScratchpadStorePrivate *priv;
+  Location *location;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  location = g_slice_new (Location);
+  location->hash = hash;
+  location->text = snippet->text;
+  location->file_path = snippet->file_path;
+  location->line_number = snippet->line_number;
+  
+  if (g_hash_table_lookup_extended (priv->locations, location, NULL, NULL))
+    {
+      location_free (location);
+      return;
+    }
+
+  g_hash_table_insert (priv->locations, location, GUINT_TO_POINTER (snippet->id));
+}
+
+static void
+remove_location (ScratchpadStore   *store,
+                 ScratchpadSnippet *snippet)
+{
+  ScratchpadStorePrivate *priv;
+  Location location;
+  gpointer id;
+  
+  priv = SCRATCHPAD_STORE_GET_PRIVATE (store);
+  
+  location.hash = g_str_hash (snippet->text);
+  location.text = snippet->text;
+  location.file_path = snippet->file_path;
+  location.line_number = snippet->line_number;
+
+  if (g_hash_table_lookup_extended (priv->locations, &location, NULL, &id) && 
+      GPOINTER_TO_UINT (id) == snippet->id)
+    g_hash_table_remove (priv->locations, &location);
+}
+
+static guint
+location_hash (Location *location)
+{
+  return location->hash ^ GPOINTER_TO_UINT (location->file_path) ^ location->line_number;
+}
+
+/*
+ * File paths are interned so comparing the pointers is enough.
+ */
+static gboolean
+location_equal (Location *location1,
+                Location *location2)
+{
+  return location1->hash == location2->hash &&
+         location1->file_path == location2->file_path &&
+         location1->line_number == location2->line_number &&
+         strcmp (location1->text, location2->text) == 0;
+}
+
+static void
+location_free (Location *location)
+{
+  g_slice_free (Location, location);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_STORE_H__
+#define	__SCRATCHPAD_STORE_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* how often a walk over the whole store lets go of the snippets it brought back */
+#define SCRATCHPAD_STORE_TRIM_INTERVAL 256
+
+/* room for the line part of a header, the colon and the number */
+#define SCRATCHPAD_STORE_LINE_SIZE 16
+
+#define SCRATCHPAD_STORE_TYPE            (scratchpad_store_get_type ())
+#define SCRATCHPAD_STORE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_STORE_TYPE, ScratchpadStore))
+#define SCRATCHPAD_STORE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_STORE_TYPE, ScratchpadStoreClass))
+#define IS_SCRATCHPAD_STORE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_STORE_TYPE))
+#define IS_SCRATCHPAD_STORE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_STORE_TYPE))
+
+typedef struct _ScratchpadStore ScratchpadStore;
+typedef struct _ScratchpadStoreClass ScratchpadStoreClass;
+
+struct _ScratchpadJournal;
+
+typedef struct
+{
+  const gchar *file_path;
+  gint         line_number;
+  gchar       *text;
+  gint64       timestamp;
+  GtkTextMark *mark;
+  GArray      *highlights;
+  GBytes      *packed;
+  GList       *used;
+  guint        id;
+  guint        record;
+  guint        count;
+  guint        anchor;
+  gint         anchor_line;
+  guint        loaded : 1;
+  guint        mapped : 1;
+  guint        indexed : 1;
+  guint        listed : 1;
+  guint        anchored : 1;
+  guint        painted : 1;
+} ScratchpadSnippet;
+
+struct _ScratchpadStore
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadStoreClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_store_get_type (void) G_GNUC_CONST;
+
+ScratchpadStore*    scratchpad_store_new         (void);
+
+void                scratchpad_store_set_journal (ScratchpadStore          *store,
+                                                  struct _ScratchpadJournal *journal);
+struct _ScratchpadJournal*
+                    scratchpad_store_get_journal (ScratchpadStore *store);
+
+ScratchpadSnippet*  scratchpad_store_add         (ScratchpadStore *store,
+                                                  const gchar     *file_path,
+                                                  gint             line_number,
+                                                  gchar           *text);
+ScratchpadSnippet*  scratchpad_store_get         (ScratchpadStore *store,
+                                                  guint            index);
+guint               scratchpad_store_get_length  (ScratchpadStore *store);
+gint                scratchpad_store_find_id     (ScratchpadStore *store,
+                                                  guint            id);
+void                scratchpad_store_remove      (ScratchpadStore *store,
+                                                  guint            index);
+guint               scratchpad_store_detach      (ScratchpadStore *store,
+                                                  guint            index);
+void                scratchpad_store_set_line    (ScratchpadStore *store,
+                                                  guint            index,
+                                                  gint             line_number);
+void                scratchpad_store_set_budget  (ScratchpadStore *store,
+                                                  gsize            budget);
+void                scratchpad_store_trim        (ScratchpadStore *store);
+gsize               scratchpad_store_get_resident (ScratchpadStore *store);
+gchar*              scratchpad_store_get_header  (ScratchpadSnippet *snippet);
+void                scratchpad_store_format_line (gint             line_number,
+                                                  gchar           *line);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_STORE_H__ */
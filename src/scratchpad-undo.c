@@ -0,0 +1,702 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "scratchpad-undo.h"
+#include "scratchpad-pane.h"
+#include "scratchpad-journal.h"
+
+/*
+ * The undo manager of the pad buffer. Everything the pane puts into the
+ * buffer itself is not undoable, so the snippet text is never copied onto
+ * the history. A capture is kept as the id of its snippet instead, and
+ * once it is undone as its journal record, which is not removed from the
+ * journal until the capture can no longer be redone. A capture without a
+ * record, when there is no journal, can not be undone and is left alone.
+ * The user's own edits are kept as text at a mark, so they stay put as 
+ * the window moves, and are forgotten when the part of the buffer they 
+ * were in goes away.
+ *
+ * Changes made within the one user action are undone together, which is
+ * also what makes a batch of captures a single step. The history is
+ * bounded to a number of actions, the oldest ones fall off the end.
+ */
+
+typedef enum
+{
+  ACTION_INSERT,
+  ACTION_DELETE,
+  ACTION_CAPTURE
+} ActionKind;
+
+typedef struct
+{
+  GtkTextMark *mark;
+  gchar       *text;
+  guint        group;
+  guint        value;
+  guint        kind : 2;
+  guint        undone : 1;
+} Action;
+
+static void scratchpad_undo_class_init     (ScratchpadUndoClass       *klass);
+static void scratchpad_undo_init           (ScratchpadUndo            *undo);
+static void scratchpad_undo_finalize       (ScratchpadUndo            *undo);
+static void undo_manager_iface_init        (GtkSourceUndoManagerIface *iface);
+
+static gboolean can_undo                   (GtkSourceUndoManager      *manager);
+static gboolean can_redo                   (GtkSourceUndoManager      *manager);
+static void undo                           (GtkSourceUndoManager      *manager);
+static void redo                           (GtkSourceUndoManager      *manager);
+static void begin_not_undoable_action      (GtkSourceUndoManager      *manager);
+static void end_not_undoable_action        (GtkSourceUndoManager      *manager);
+
+static gboolean undo_action                (ScratchpadUndo            *undo,
+                                            Action                    *action);
+static gboolean redo_action                (ScratchpadUndo            *undo,
+                                            Action                    *action);
+static void insert_text                    (ScratchpadUndo            *undo,
+                                            Action                    *action);
+static void delete_text                    (ScratchpadUndo            *undo,
+                                            Action                    *action);
+static Action* action_new                  (ScratchpadUndo            *undo,
+                                            ActionKind                 kind);
+static void action_free                    (ScratchpadUndo            *undo,
+                                            Action                    *action);
+static void push_action                    (ScratchpadUndo            *undo,
+                                            Action                    *action);
+static void clear_redo                     (ScratchpadUndo            *undo);
+static void forget_range                   (ScratchpadUndo            *undo,
+                                            GQueue                    *queue,
+                                            gint                       start_offset,
+                                            gint                       end_offset);
+static void notify_changes                 (ScratchpadUndo            *undo,
+                                            gboolean                   could_undo,
+                                            gboolean                   could_redo);
+static void insert_text_action             (ScratchpadUndo            *undo,
+                                            GtkTextIter               *iter,
+                                            gchar                     *text,
+                                            gint                       len);
+static void delete_range_action            (ScratchpadUndo            *undo,
+                                            GtkTextIter               *start,
+                                            GtkTextIter               *end);
+static void begin_user_action              (ScratchpadUndo            *undo);
+static void end_user_action                (ScratchpadUndo            *undo);
+
+#define SCRATCHPAD_UNDO_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SCRATCHPAD_UNDO_TYPE, ScratchpadUndoPrivate))
+
+typedef struct _ScratchpadUndoPrivate ScratchpadUndoPrivate;
+
+struct _ScratchpadUndoPrivate
+{
+  struct _ScratchpadPane *pane;
+  GtkTextBuffer          *buffer;
+  ScratchpadStore        *store;
+  GQueue                 *undo;
+  GQueue                 *redo;
+  guint                   depth;
+  guint                   group;
+  guint                   not_undoable;
+  gboolean                user_action;
+  gboolean                running;
+};
+
+G_DEFINE_TYPE_WITH_CODE (ScratchpadUndo, scratchpad_undo, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GTK_SOURCE_TYPE_UNDO_MANAGER,
+                                                undo_manager_iface_init))
+
+static void
+scratchpad_undo_class_init (ScratchpadUndoClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) scratchpad_undo_finalize;
+  g_type_class_add_private (klass, sizeof (ScratchpadUndoPrivate));
+}
+
+static void
+undo_manager_iface_init (GtkSourceUndoManagerIface *iface)
+{
+  iface->can_undo = can_undo;
+  iface->can_redo = can_redo;
+  iface->undo = undo;
+  iface->redo = redo;
+  iface->begin_not_undoable_action = begin_not_undoable_action;
+  iface->end_not_undoable_action = end_not_undoable_action;
+}
+
+static void
+scratchpad_undo_init (ScratchpadUndo *undo)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+  priv->undo = g_queue_new ();
+  priv->redo = g_queue_new ();
+  priv->depth = SCRATCHPAD_UNDO_DEFAULT_DEPTH;
+  priv->group = 0;
+  priv->not_undoable = 0;
+  priv->user_action = FALSE;
+  priv->running = FALSE;
+}
+
+/*
+ * The marks only need deleting if the buffer is still around.
+ */
+static void
+scratchpad_undo_finalize (ScratchpadUndo *undo)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  while (!g_queue_is_empty (priv->undo))
+    action_free (undo, g_queue_pop_head (priv->undo));
+  while (!g_queue_is_empty (priv->redo))
+    action_free (undo, g_queue_pop_head (priv->redo));
+
+  g_queue_free (priv->undo);
+  g_queue_free (priv->redo);
+
+  if (priv->buffer != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (priv->buffer, undo);
+      g_object_remove_weak_pointer (G_OBJECT (priv->buffer), (gpointer*) &priv->buffer);
+    }
+
+  g_object_unref (priv->store);
+
+  G_OBJECT_CLASS (scratchpad_undo_parent_class)->finalize (G_OBJECT (undo));
+}
+
+ScratchpadUndo*
+scratchpad_undo_new (struct _ScratchpadPane *pane,
+                     GtkTextBuffer          *buffer,
+                     ScratchpadStore        *store)
+{
+  ScratchpadUndoPrivate *priv;
+  ScratchpadUndo *undo;
+
+  undo = SCRATCHPAD_UNDO (g_object_new (scratchpad_undo_get_type (), NULL));
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  priv->pane = pane;
+  priv->buffer = buffer;
+  priv->store = g_object_ref (store);
+  g_object_add_weak_pointer (G_OBJECT (buffer), (gpointer*) &priv->buffer);
+
+  g_signal_connect_swapped (G_OBJECT (buffer), "insert-text",
+                            G_CALLBACK (insert_text_action), undo);
+  g_signal_connect_swapped (G_OBJECT (buffer), "delete-range",
+                            G_CALLBACK (delete_range_action), undo);
+  g_signal_connect_swapped (G_OBJECT (buffer), "begin-user-action",
+                            G_CALLBACK (begin_user_action), undo);
+  g_signal_connect_swapped (G_OBJECT (buffer), "end-user-action",
+                            G_CALLBACK (end_user_action), undo);
+
+  return undo;
+}
+
+/*
+ * A depth of zero keeps no history at all.
+ */
+void
+scratchpad_undo_set_depth (ScratchpadUndo *undo,
+                           guint           depth)
+{
+  ScratchpadUndoPrivate *priv;
+  gboolean could_undo, could_redo;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  could_undo = can_undo (GTK_SOURCE_UNDO_MANAGER (undo));
+  could_redo = can_redo (GTK_SOURCE_UNDO_MANAGER (undo));
+
+  priv->depth = depth;
+
+  while (g_queue_get_length (priv->undo) > depth)
+    action_free (undo, g_queue_pop_tail (priv->undo));
+  while (g_queue_get_length (priv->redo) > depth)
+    action_free (undo, g_queue_pop_tail (priv->redo));
+
+  notify_changes (undo, could_undo, could_redo);
+}
+
+/*
+ * Called by the pane for every new snippet. The id is all that is kept.
+ */
+void
+scratchpad_undo_add_capture (ScratchpadUndo *undo,
+                             guint           id)
+{
+  ScratchpadUndoPrivate *priv;
+  Action *action;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  /* a redo bringing a capture back */
+  if (priv->running)
+    return;
+
+  action = action_new (undo, ACTION_CAPTURE);
+  action->value = id;
+  push_action (undo, action);
+}
+
+static gboolean
+can_undo (GtkSourceUndoManager *manager)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (manager);
+  return !g_queue_is_empty (priv->undo);
+}
+
+static gboolean
+can_redo (GtkSourceUndoManager *manager)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (manager);
+  return !g_queue_is_empty (priv->redo);
+}
+
+/*
+ * An action that can not be undone, say a capture that was removed by
+ * hand in the meantime, is dropped along the way.
+ */
+static void
+undo (GtkSourceUndoManager *manager)
+{
+  ScratchpadUndo *undo = SCRATCHPAD_UNDO (manager);
+  ScratchpadUndoPrivate *priv;
+  Action *action;
+  guint group;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  action = g_queue_peek_head (priv->undo);
+  if (action == NULL)
+    return;
+
+  group = action->group;
+  priv->running = TRUE;
+
+  while ((action = g_queue_peek_head (priv->undo)) != NULL && action->group == group)
+    {
+      g_queue_pop_head (priv->undo);
+      if (undo_action (undo, action))
+        g_queue_push_head (priv->redo, action);
+      else
+        action_free (undo, action);
+    }
+
+  priv->running = FALSE;
+
+  notify_changes (undo, TRUE, !g_queue_is_empty (priv->redo));
+}
+
+static void
+redo (GtkSourceUndoManager *manager)
+{
+  ScratchpadUndo *undo = SCRATCHPAD_UNDO (manager);
+  ScratchpadUndoPrivate *priv;
+  Action *action;
+  guint group;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  action = g_queue_peek_head (priv->redo);
+  if (action == NULL)
+    return;
+
+  group = action->group;
+  priv->running = TRUE;
+
+  while ((action = g_queue_peek_head (priv->redo)) != NULL && action->group == group)
+    {
+      g_queue_pop_head (priv->redo);
+      if (redo_action (undo, action))
+        g_queue_push_head (priv->undo, action);
+      else
+        action_free (undo, action);
+    }
+
+  priv->running = FALSE;
+
+  notify_changes (undo, !g_queue_is_empty (priv->undo), TRUE);
+}
+
+static void
+begin_not_undoable_action (GtkSourceUndoManager *manager)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (manager);
+  priv->not_undoable++;
+}
+
+static void
+end_not_undoable_action (GtkSourceUndoManager *manager)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (manager);
+  g_return_if_fail (priv->not_undoable > 0);
+  priv->not_undoable--;
+}
+
+static gboolean
+undo_action (ScratchpadUndo *undo,
+             Action         *action)
+{
+  ScratchpadUndoPrivate *priv;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  switch (action->kind)
+    {
+    case ACTION_INSERT:
+      delete_text (undo, action);
+      break;
+    case ACTION_DELETE:
+      insert_text (undo, action);
+      break;
+    case ACTION_CAPTURE:
+      action->value = scratchpad_pane_detach_snippet (SCRATCHPAD_PANE (priv->pane),
+                                                      action->value);
+      if (action->value == G_MAXUINT)
+        return FALSE;
+      break;
+    }
+
+  action->undone = TRUE;
+  return TRUE;
+}
+
+static gboolean
+redo_action (ScratchpadUndo *undo,
+             Action         *action)
+{
+  ScratchpadUndoPrivate *priv;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  switch (action->kind)
+    {
+    case ACTION_INSERT:
+      insert_text (undo, action);
+      break;
+    case ACTION_DELETE:
+      delete_text (undo, action);
+      break;
+    case ACTION_CAPTURE:
+      if (!scratchpad_pane_attach_record (SCRATCHPAD_PANE (priv->pane),
+                                          action->value, &action->value))
+        {
+          /* the record is no good any more, there is nothing to remove */
+          action->undone = FALSE;
+          return FALSE;
+        }
+      break;
+    }
+
+  action->undone = FALSE;
+  return TRUE;
+}
+
+/*
+ * The mark has left gravity so it stays in front of the text going in.
+ */
+static void
+insert_text (ScratchpadUndo *undo,
+             Action         *action)
+{
+  ScratchpadUndoPrivate *priv;
+  GtkTextIter iter;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, action->mark);
+  gtk_text_buffer_insert (priv->buffer, &iter, action->text, -1);
+  gtk_text_buffer_place_cursor (priv->buffer, &iter);
+}
+
+static void
+delete_text (ScratchpadUndo *undo,
+             Action         *action)
+{
+  ScratchpadUndoPrivate *priv;
+  GtkTextIter start, end;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  gtk_text_buffer_get_iter_at_mark (priv->buffer, &start, action->mark);
+  end = start;
+  gtk_text_iter_forward_chars (&end, g_utf8_strlen (action->text, -1));
+  gtk_text_buffer_delete (priv->buffer, &start, &end);
+  gtk_text_buffer_place_cursor (priv->buffer, &start);
+}
+
+/*
+ * Everything within a user action goes in the one group.
+ */
+static Action*
+action_new (ScratchpadUndo *undo,
+            ActionKind      kind)
+{
+  ScratchpadUndoPrivate *priv;
+  Action *action;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  action = g_slice_new0 (Action);
+  action->kind = kind;
+  action->group = priv->user_action ? priv->group : ++priv->group;
+
+  return action;
+}
+
+/*
+ * A capture that was undone and can no longer be redone is gone for good.
+ */
+static void
+action_free (ScratchpadUndo *undo,
+             Action         *action)
+{
+  ScratchpadUndoPrivate *priv;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  if (action->mark != NULL && priv->buffer != NULL)
+    gtk_text_buffer_delete_mark (priv->buffer, action->mark);
+
+  if (action->kind == ACTION_CAPTURE && action->undone)
+    {
+      ScratchpadJournal *journal = scratchpad_store_get_journal (priv->store);
+      if (journal != NULL)
+        scratchpad_journal_remove (journal, action->value);
+    }
+
+  g_free (action->text);
+  g_slice_free (Action, action);
+}
+
+static void
+push_action (ScratchpadUndo *undo,
+             Action         *action)
+{
+  ScratchpadUndoPrivate *priv;
+  gboolean could_undo, could_redo;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  could_undo = !g_queue_is_empty (priv->undo);
+  could_redo = !g_queue_is_empty (priv->redo);
+
+  clear_redo (undo);
+
+  g_queue_push_head (priv->undo, action);
+  while (g_queue_get_length (priv->undo) > priv->depth)
+    action_free (undo, g_queue_pop_tail (priv->undo));
+
+  notify_changes (undo, could_undo, could_redo);
+}
+
+static void
+clear_redo (ScratchpadUndo *undo)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+  while (!g_queue_is_empty (priv->redo))
+    action_free (undo, g_queue_pop_head (priv->redo));
+}
+
+/*
+ * The range is going out of the buffer without the user doing it, so the
+ * edits that were made in it can not be undone any more.
+ */
+static void
+forget_range (ScratchpadUndo *undo,
+              GQueue         *queue,
+              gint            start_offset,
+              gint            end_offset)
+{
+  ScratchpadUndoPrivate *priv;
+  GList *list;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  list = queue->head;
+  while (list != NULL)
+    {
+      Action *action = list->data;
+      GList *next = list->next;
+
+      if (action->mark != NULL)
+        {
+          GtkTextIter iter;
+          gint offset;
+
+          gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, action->mark);
+          offset = gtk_text_iter_get_offset (&iter);
+
+          if (offset >= start_offset && offset <= end_offset)
+            {
+              g_queue_delete_link (queue, list);
+              action_free (undo, action);
+            }
+        }
+
+      list = next;
+    }
+}
+
+static void
+notify_changes (ScratchpadUndo *undo,
+                gboolean        could_undo,
+                gboolean        could_redo)
+{
+  ScratchpadUndoPrivate *priv;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  if (could_undo != !g_queue_is_empty (priv->undo))
+    gtk_source_undo_manager_can_undo_changed (GTK_SOURCE_UNDO_MANAGER (undo));
+  if (could_redo != !g_queue_is_empty (priv->redo))
+    gtk_source_undo_manager_can_redo_changed (GTK_SOURCE_UNDO_MANAGER (undo));
+}
+
+/*
+ * Typing goes onto the last insert a word at a time.
+ */
+static void
+insert_text_action (ScratchpadUndo *undo,
+                    GtkTextIter    *iter,
+                    gchar          *text,
+                    gint            len)
+{
+  ScratchpadUndoPrivate *priv;
+  Action *action;
+  gint offset;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  if (priv->running || priv->not_undoable > 0 || priv->depth == 0)
+    return;
+
+  offset = gtk_text_iter_get_offset (iter);
+  action = g_queue_peek_head (priv->undo);
+
+  if (action != NULL && action->kind == ACTION_INSERT &&
+      g_queue_is_empty (priv->redo) &&
+      g_utf8_strlen (text, len) == 1 && text[0] != '\n' &&
+      (!g_ascii_isspace (action->text[strlen (action->text) - 1]) || g_ascii_isspace (text[0])))
+    {
+      GtkTextIter start;
+      gtk_text_buffer_get_iter_at_mark (priv->buffer, &start, action->mark);
+      if (gtk_text_iter_get_offset (&start) + g_utf8_strlen (action->text, -1) == offset)
+        {
+          gchar *joined = g_strdup_printf ("%s%.*s", action->text, len, text);
+          g_free (action->text);
+          action->text = joined;
+          return;
+        }
+    }
+
+  action = action_new (undo, ACTION_INSERT);
+  action->mark = gtk_text_buffer_create_mark (priv->buffer, NULL, iter, TRUE);
+  action->text = g_strndup (text, len);
+  push_action (undo, action);
+}
+
+/*
+ * Backspace and delete go onto the last delete a character at a time.
+ */
+static void
+delete_range_action (ScratchpadUndo *undo,
+                     GtkTextIter    *start,
+                     GtkTextIter    *end)
+{
+  ScratchpadUndoPrivate *priv;
+  Action *action;
+  gchar *text;
+  gint start_offset;
+  gint end_offset;
+
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+
+  start_offset = gtk_text_iter_get_offset (start);
+  end_offset = gtk_text_iter_get_offset (end);
+
+  if (priv->not_undoable > 0)
+    {
+      /* an edit just past the end is in the next snippet, unless there is none */
+      if (!gtk_text_iter_is_end (end))
+        end_offset--;
+      forget_range (undo, priv->undo, start_offset, end_offset);
+      forget_range (undo, priv->redo, start_offset, end_offset);
+      return;
+    }
+
+  if (priv->running || priv->depth == 0)
+    return;
+
+  text = gtk_text_iter_get_text (start, end);
+  action = g_queue_peek_head (priv->undo);
+
+  if (action != NULL && action->kind == ACTION_DELETE &&
+      g_queue_is_empty (priv->redo) &&
+      end_offset - start_offset == 1 && text[0] != '\n')
+    {
+      GtkTextIter iter;
+      gint offset;
+
+      gtk_text_buffer_get_iter_at_mark (priv->buffer, &iter, action->mark);
+      offset = gtk_text_iter_get_offset (&iter);
+
+      if (offset == end_offset || offset == start_offset)
+        {
+          gchar *joined;
+          if (offset == end_offset)
+            joined = g_strconcat (text, action->text, NULL);
+          else
+            joined = g_strconcat (action->text, text, NULL);
+          g_free (action->text);
+          g_free (text);
+          action->text = joined;
+          return;
+        }
+    }
+
+  action = action_new (undo, ACTION_DELETE);
+  action->mark = gtk_text_buffer_create_mark (priv->buffer, NULL, start, TRUE);
+  action->text = text;
+  push_action (undo, action);
+}
+
+static void
+begin_user_action (ScratchpadUndo *undo)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+  priv->group++;
+  priv->user_action = TRUE;
+}
+
+static void
+end_user_action (ScratchpadUndo *undo)
+{
+  ScratchpadUndoPrivate *priv;
+  priv = SCRATCHPAD_UNDO_GET_PRIVATE (undo);
+  priv->user_action = FALSE;
+}
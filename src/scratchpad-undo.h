@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCRATCHPAD_UNDO_H__
+#define	__SCRATCHPAD_UNDO_H__
+
+#include <gtk/gtk.h>
+#include <gtksourceview/gtksourceundomanager.h>
+#include "scratchpad-store.h"
+
+G_BEGIN_DECLS
+
+#define SCRATCHPAD_UNDO_DEPTH "scratchpad_undo_depth"
+#define SCRATCHPAD_UNDO_DEFAULT_DEPTH 200
+
+#define SCRATCHPAD_UNDO_TYPE            (scratchpad_undo_get_type ())
+#define SCRATCHPAD_UNDO(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SCRATCHPAD_UNDO_TYPE, ScratchpadUndo))
+#define SCRATCHPAD_UNDO_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SCRATCHPAD_UNDO_TYPE, ScratchpadUndoClass))
+#define IS_SCRATCHPAD_UNDO(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SCRATCHPAD_UNDO_TYPE))
+#define IS_SCRATCHPAD_UNDO_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SCRATCHPAD_UNDO_TYPE))
+
+typedef struct _ScratchpadUndo ScratchpadUndo;
+typedef struct _ScratchpadUndoClass ScratchpadUndoClass;
+
+struct _ScratchpadPane;
+
+struct _ScratchpadUndo
+{
+  GObject parent_instance;
+};
+
+struct _ScratchpadUndoClass
+{
+  GObjectClass parent_class;
+};
+
+GType scratchpad_undo_get_type (void) G_GNUC_CONST;
+
+ScratchpadUndo*  scratchpad_undo_new          (struct _ScratchpadPane *pane,
+                                               GtkTextBuffer          *buffer,
+                                               ScratchpadStore        *store);
+
+void             scratchpad_undo_set_depth    (ScratchpadUndo         *undo,
+                                               guint                   depth);
+
+void             scratchpad_undo_add_capture  (ScratchpadUndo         *undo,
+                                               guint                   id);
+
+G_END_DECLS
+
+#endif /* __SCRATCHPAD_UNDO_H__ */